@@ -0,0 +1,306 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Benchmarks of the hot paths of startup and search, on synthetic data so
+// the numbers don't depend on the mirror or on what the host has installed.
+
+#include "alpm_helper.hpp"
+#include "cacheprune.hpp"
+#include "catalog.hpp"
+#include "fakedb.hpp"
+#include "ini.hpp"
+#include "pacmancache.hpp"
+#include "treefilter.hpp"
+#include "upgrades.hpp"
+#include "utils.hpp"
+#include "versionnumber.hpp"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include <QApplication>
+#include <QTreeWidget>
+
+#include <benchmark/benchmark.h>
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+// columns of treePopularApps, see PopCol in mainwindow.hpp
+constexpr int col_name        = 2;
+constexpr int col_description = 4;
+
+std::string temp_file(std::string_view name, std::string_view content) {
+    const auto& path = (fs::temp_directory_path() / fmt::format("cachyos-pi-bench-{}-{}", ::getpid(), name)).string();
+    std::ofstream file{path};
+    file << content;
+    return path;
+}
+
+// pkglist.yaml layout: groups with packages, every fourth one with subgroups
+std::string make_catalog_yaml(std::size_t apps) {
+    std::string yaml{};
+    std::size_t app{};
+    for (std::size_t group = 0; app < apps; ++group) {
+        yaml += fmt::format("- name: \"Group {}\"\n", group);
+        if (group % 4 == 0) {
+            yaml += "  subgroups:\n";
+            for (std::size_t sub = 0; sub < 3 && app < apps; ++sub) {
+                yaml += fmt::format("      - name: \"Subgroup {}.{}\"\n        packages:\n", group, sub);
+                for (std::size_t i = 0; i < 8 && app < apps; ++i, ++app) {
+                    yaml += fmt::format("           - pkg{:05} pkg{:05}-extra\n", app, app);
+                }
+            }
+            continue;
+        }
+        yaml += "  packages:\n";
+        for (std::size_t i = 0; i < 24 && app < apps; ++i, ++app) {
+            yaml += fmt::format("    - pkg{:05}\n", app);
+        }
+    }
+    return yaml;
+}
+
+// count distinct package names split over two repositories, one in 25 of
+// the core packages is installed in some other version
+struct SyncFixture {
+    FakeRoot root{};
+    alpm_handle_t* handle{};
+    std::string conf{};
+
+    explicit SyncFixture(std::size_t count) {
+        auto installed = generate_packages({.count = count / 2, .seed = 3});
+        std::vector<FakePackage> local{};
+        for (std::size_t i = 0; i < installed.size(); i += 25) {
+            local.push_back(std::move(installed[i]));
+        }
+        if (!root.add_sync_db("core", generate_packages({.count = count / 2, .seed = 1}))
+            || !root.add_sync_db("extra", generate_packages({.count = count / 2, .prefix = "extra", .seed = 2}))
+            || !root.add_local(local)) {
+            return;
+        }
+        conf = root.write_conf();
+        alpm_errno_t err{};
+        handle = init_alpm(&err, conf);
+        if (handle == nullptr) {
+            spdlog::error("failed to open the fake databases: {}", alpm_strerror(err));
+            return;
+        }
+        // load the package caches up front, the benchmarks measure what uses them
+        for (auto* i = alpm_get_syncdbs(handle); i != nullptr; i = i->next) {
+            alpm_db_get_pkgcache(static_cast<alpm_db_t*>(i->data));
+        }
+        alpm_db_get_pkgcache(alpm_get_localdb(handle));
+    }
+    ~SyncFixture() { destroy_alpm(handle); }
+
+    // nullptr if the databases couldn't be generated or opened
+    static SyncFixture* get(std::size_t count) {
+        static std::unordered_map<std::size_t, std::unique_ptr<SyncFixture>> fixtures{};
+        auto& fixture = fixtures[count];
+        if (!fixture) {
+            fixture = std::make_unique<SyncFixture>(count);
+        }
+        return (fixture->handle != nullptr) ? fixture.get() : nullptr;
+    }
+};
+
+void BM_LoadCatalog(benchmark::State& state) {
+    const auto& path = temp_file("pkglist.yaml", make_catalog_yaml(static_cast<std::size_t>(state.range(0))));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(load_catalog(path));
+    }
+    fs::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadCatalog)->Arg(500)->Arg(5000)->Unit(benchmark::kMillisecond);
+
+void BM_SyncDbLoad(benchmark::State& state) {
+    auto* fixture = SyncFixture::get(static_cast<std::size_t>(state.range(0)));
+    if (fixture == nullptr) {
+        state.SkipWithError("failed to set up the package databases");
+        return;
+    }
+    for (auto _ : state) {
+        alpm_errno_t err{};
+        auto* handle = init_alpm(&err, fixture->conf);
+        std::size_t count{};
+        for (auto* i = alpm_get_syncdbs(handle); i != nullptr; i = i->next) {
+            count += alpm_list_count(alpm_db_get_pkgcache(static_cast<alpm_db_t*>(i->data)));
+        }
+        benchmark::DoNotOptimize(count);
+        destroy_alpm(handle);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SyncDbLoad)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+void BM_CandidateMerge(benchmark::State& state) {
+    auto* fixture = SyncFixture::get(static_cast<std::size_t>(state.range(0)));
+    if (fixture == nullptr) {
+        state.SkipWithError("failed to set up the package databases");
+        return;
+    }
+    for (auto _ : state) {
+        const PacmanCache cache{fixture->handle};
+        benchmark::DoNotOptimize(cache.get_candidates().size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CandidateMerge)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// 100000 available packages against 2000 installed ones
+void BM_FindUpgrades(benchmark::State& state) {
+    auto* fixture = SyncFixture::get(static_cast<std::size_t>(state.range(0)));
+    if (fixture == nullptr) {
+        state.SkipWithError("failed to set up the package databases");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(find_upgrades(fixture->handle).upgrades.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FindUpgrades)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// the search of MainWindow::findPopular over a tree built like
+// displayPopularApps does
+void BM_FindPopular(benchmark::State& state) {
+    QTreeWidget tree{};
+    tree.setColumnCount(col_description + 1);
+    QTreeWidgetItem* group{};
+    QTreeWidgetItem* category{};
+    const auto& pkgs = generate_packages({.count = static_cast<std::size_t>(state.range(0))});
+    for (std::size_t i = 0; i < pkgs.size(); ++i) {
+        if (i % 200 == 0) {
+            group = new QTreeWidgetItem(&tree);
+            group->setText(col_name, QString::fromStdString(fmt::format("Group {}", i / 200)));
+        }
+        if (i % 25 == 0) {
+            category = new QTreeWidgetItem(group);
+            category->setText(col_name, QString::fromStdString(fmt::format("Category {}", i / 25)));
+        }
+        auto* item = new QTreeWidgetItem(category);
+        item->setText(col_name, QString::fromStdString(pkgs[i].name));
+        item->setText(col_description, QString::fromStdString(pkgs[i].desc));
+    }
+
+    const QString word{"brows"};
+    for (auto _ : state) {
+        filter_tree(&tree, word, col_name, col_description);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FindPopular)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// a package cache of signed packages, four versions of each, as the
+// Clean up button and --prune-cache see it; the removal is a dry run
+void BM_CachePrune(benchmark::State& state) {
+    const auto& cachedir = fs::temp_directory_path() / fmt::format("cachyos-pi-bench-{}-cache", ::getpid());
+    fs::create_directories(cachedir);
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        const auto& filename = fmt::format("pkg{:05}-1.{}-1-x86_64.pkg.tar.zst", i / 4, i % 4);
+        std::ofstream{cachedir / filename};
+        std::ofstream{cachedir / (filename + ".sig")};
+    }
+
+    for (auto _ : state) {
+        PackageCacheIndex cache_index(std::vector<std::string>{cachedir.string()});
+        cache_index.scan();
+        const auto& report = cache_index.plan(default_keep_versions);
+        benchmark::DoNotOptimize(PackageCacheIndex::remove(report, true));
+    }
+    fs::remove_all(cachedir);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CachePrune)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+void BM_VersionCompare(benchmark::State& state) {
+    const auto& pkgs = generate_packages({.count = static_cast<std::size_t>(state.range(0))});
+    std::vector<VersionNumber> versions{};
+    versions.reserve(pkgs.size());
+    for (const auto& pkg : pkgs) {
+        versions.emplace_back(pkg.version);
+    }
+
+    for (auto _ : state) {
+        std::size_t older{};
+        for (std::size_t i = 1; i < versions.size(); ++i) {
+            older += static_cast<std::size_t>(versions[i - 1] <= versions[i]);
+        }
+        benchmark::DoNotOptimize(older);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VersionCompare)->Arg(100000);
+
+// pacman.conf with many repositories and a long mirrorlist
+void BM_IniParse(benchmark::State& state) {
+    std::string ini{"[options]\nHoldPkg = pacman glibc\nArchitecture = auto\nParallelDownloads = 5\nSigLevel = Required DatabaseOptional\n"};
+    for (std::int64_t repo = 0; repo < state.range(0); ++repo) {
+        ini += fmt::format("\n[repo{}]\nSigLevel = Optional TrustAll\n", repo);
+        for (int server = 0; server < 20; ++server) {
+            ini += fmt::format("Server = https://mirror{}.example.org/$repo/os/$arch\n", server);
+        }
+    }
+    const auto& path = temp_file("pacman.conf", ini);
+
+    const mINI::INIFile file{path};
+    for (auto _ : state) {
+        mINI::INIStructure data{};
+        benchmark::DoNotOptimize(file.read(data));
+    }
+    fs::remove(path);
+}
+BENCHMARK(BM_IniParse)->Arg(10)->Arg(100);
+
+void BM_MakeMultiline(benchmark::State& state) {
+    std::string str{};
+    for (const auto& pkg : generate_packages({.count = static_cast<std::size_t>(state.range(0))})) {
+        str += pkg.name;
+        str += ' ';
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(utils::make_multiline(str, false, " "));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MakeMultiline)->Arg(100)->Arg(10000);
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    // the search benchmark needs widgets, but no display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    spdlog::set_level(spdlog::level::warn);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
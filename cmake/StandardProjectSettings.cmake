@@ -59,6 +59,12 @@ if(NOT ENABLE_DEVENV)
   add_definitions(-DNDEVENV)
 endif()
 
+# Startup phase timers, only recorded when run with --profile.
+option(ENABLE_PROFILER "Enable startup profiler instrumentation" ON)
+if(NOT ENABLE_PROFILER)
+  add_definitions(-DNPROFILER)
+endif()
+
 # Choose pkg operation implementation.
 # Note: temporal fix
 option(PKG_DUMMY_IMPL "Use dummy implementation of install/uninstall operations" ON)
@@ -15,14 +15,27 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "alpm_helper.hpp"
-#include "ini.hpp"
-#include "utils.hpp"
+#include "alpmlist.hpp"
+#include "journal.hpp"
+#include "pacmanconf.hpp"
+#include "pkgindex.hpp"
+#include "profiler.hpp"
 
-#include <sys/utsname.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
 
 #include <fmt/core.h>
 #include <spdlog/spdlog.h>
 
+/* bumped whenever the databases behind the handle may have changed */
+static std::atomic<std::uint64_t> g_db_generation{};
+
+/* how long to queue behind another package manager holding the database lock */
+static std::chrono::milliseconds g_db_lock_timeout{std::chrono::minutes{10}};
+static lock_wait_cb g_db_lock_wait_cb{};
+
 typedef struct _pm_target_t {
     alpm_pkg_t* remove;
     alpm_pkg_t* install;
@@ -39,6 +52,11 @@ void cb_progress(void* ctx, alpm_progress_t event, const char* pkgname,
 /* callback to handle messages/notifications from pacman library */
 __attribute__((format(printf, 3, 0))) void cb_log(void* ctx, alpm_loglevel_t level, const char* fmt, va_list args);
 
+/* callback to answer questions from libalpm, there is nobody to ask so
+ * the defaults pacman picks with --noconfirm are used, a non-null ctx
+ * removes conflicting packages instead of refusing to */
+void cb_question(void* ctx, alpm_question_t* question);
+
 void cb_event(void* ctx, alpm_event_t* event) {
     (void)ctx;
 
@@ -55,6 +73,8 @@ void cb_event(void* ctx, alpm_event_t* event) {
         break;
     case ALPM_EVENT_TRANSACTION_START:
         spdlog::info("ALPM: :: Processing package changes...");
+        // downloads are done, from here on the system itself changes
+        TransactionJournal::instance().installing();
         break;
 
     case ALPM_EVENT_FILECONFLICTS_START:
@@ -149,6 +169,32 @@ void cb_progress(void* ctx, alpm_progress_t event, const char* pkgname, int perc
     spdlog::info("({}/{}) {}", remain, howmany, opr);
 }
 
+void cb_question(void* ctx, alpm_question_t* question) {
+    switch (question->type) {
+    case ALPM_QUESTION_INSTALL_IGNOREPKG:
+        question->install_ignorepkg.install = 1;
+        break;
+    case ALPM_QUESTION_REPLACE_PKG:
+        question->replace.replace = 1;
+        break;
+    case ALPM_QUESTION_CONFLICT_PKG:
+        question->conflict.remove = (ctx != nullptr) ? 1 : 0;
+        break;
+    case ALPM_QUESTION_REMOVE_PKGS:
+        question->remove_pkgs.skip = 0;
+        break;
+    case ALPM_QUESTION_SELECT_PROVIDER:
+        question->select_provider.use_index = 0;
+        break;
+    case ALPM_QUESTION_CORRUPTED_PKG:
+        question->corrupted.remove = 1;
+        break;
+    case ALPM_QUESTION_IMPORT_KEY:
+        question->import_key.import = 1;
+        break;
+    }
+}
+
 void cb_log(void* ctx, alpm_loglevel_t level, const char* fmt, va_list args) {
     (void)ctx;
     if (!fmt || strlen(fmt) == 0) {
@@ -183,99 +229,95 @@ void cb_log(void* ctx, alpm_loglevel_t level, const char* fmt, va_list args) {
     }
 }
 
-namespace utils {
 namespace {
-inline std::size_t replace_all(std::string& inout, const std::string_view& what, const std::string_view& with) {
-    std::size_t count{};
-    std::size_t pos{};
-    while (std::string::npos != (pos = inout.find(what.data(), pos, what.length()))) {
-        inout.replace(pos, what.length(), with.data(), with.length());
-        pos += with.length(), ++count;
+struct db_update_ctx {
+    const db_progress_cb* progress_cb{};
+    std::vector<std::string>* changed_dbs{};
+    std::unordered_map<std::string, int> last_percent{};
+};
+
+/* callback to handle sync database downloads started by alpm_db_update */
+void cb_db_download(void* ctx, const char* filename, alpm_download_event_type_t event, void* data) {
+    auto* update_ctx = static_cast<db_update_ctx*>(ctx);
+
+    std::string_view dbname{filename};
+    // signature files are fetched alongside their database
+    if (dbname.ends_with(".sig")) {
+        return;
+    }
+    if (dbname.ends_with(".db")) {
+        dbname.remove_suffix(3);
     }
-    return count;
-}
-
-inline std::size_t remove_all(std::string& inout, const std::string_view& what) {
-    return replace_all(inout, what, "");
-}
-
-void parse_cachedirs(alpm_handle_t* handle) noexcept {
-    static constexpr auto cachedir = "/var/cache/pacman/pkg/";
-
-    alpm_list_t* cachedirs = nullptr;
-    cachedirs              = alpm_list_add(cachedirs, const_cast<void*>(reinterpret_cast<const void*>(cachedir)));
-    alpm_option_set_cachedirs(handle, cachedirs);
-}
-
-void parse_includes(alpm_handle_t* handle, alpm_db_t* db, const auto& section, const auto& file) noexcept {
-    const auto* archs = alpm_option_get_architectures(handle);
-    const auto* arch  = reinterpret_cast<const char*>(archs->data);
 
-    mINI::INIFile file_nested(file);
-    // next, create a structure that will hold data
-    mINI::INIStructure mirrorlist;
+    const auto& report = [update_ctx, dbname](int percent) {
+        auto& last_percent = update_ctx->last_percent[std::string{dbname}];
+        if (last_percent == percent || !*update_ctx->progress_cb) {
+            return;
+        }
+        last_percent = percent;
+        (*update_ctx->progress_cb)(dbname, percent);
+    };
 
-    // now we can read the file
-    file_nested.read(mirrorlist);
-    for (const auto& mirror : mirrorlist) {
-        auto repo = mirror.second.begin()->second;
-        if (repo.starts_with("/")) {
-            continue;
+    switch (event) {
+    case ALPM_DOWNLOAD_PROGRESS: {
+        const auto* progress = static_cast<alpm_download_event_progress_t*>(data);
+        if (progress->total > 0) {
+            report(static_cast<int>(progress->downloaded * 100 / progress->total));
         }
-        utils::replace_all(repo, "$arch", arch);
-        utils::replace_all(repo, "$repo", section.c_str());
-        alpm_db_add_server(db, repo.c_str());
+        break;
+    }
+    case ALPM_DOWNLOAD_COMPLETED: {
+        // result: 0 - downloaded, 1 - already up to date, -1 - failed
+        const auto* completed = static_cast<alpm_download_event_completed_t*>(data);
+        if (completed->result == 0) {
+            update_ctx->changed_dbs->emplace_back(dbname);
+        }
+        if (completed->result >= 0) {
+            report(100);
+        }
+        break;
+    }
+    default:
+        break;
     }
 }
+}  // namespace
 
-void parse_repos(alpm_handle_t* handle) noexcept {
-    static constexpr auto pacman_conf_path = "/etc/pacman.conf";
-
-    mINI::INIFile file(pacman_conf_path);
-    // next, create a structure that will hold data
-    mINI::INIStructure ini;
-
-    // now we can read the file
-    file.read(ini);
-    for (const auto& it : ini) {
-        const auto& section = it.first;
-        const auto& nested  = it.second;
-        if (section == "options") {
-            for (const auto& it_nested : nested) {
-                if (it_nested.first != "architecture") {
-                    continue;
-                }
-                // add CacheDir
-                const auto& archs = ::utils::make_multiline(it_nested.second, false, " ");
-                for (const auto& arch : archs) {
-                    if (arch == "auto") {
-                        struct utsname un;
-                        uname(&un);
-                        char* tmp = un.machine;
-                        if (tmp != nullptr) {
-                            alpm_option_add_architecture(handle, tmp);
-                        }
-                        continue;
-                    }
-
-                    alpm_option_add_architecture(handle, arch.c_str());
-                }
-            }
+namespace {
+void apply_config(alpm_handle_t* handle, const PacmanConfig& config) noexcept {
+    alpm_option_set_logfile(handle, config.logfile.c_str());
+    alpm_option_set_gpgdir(handle, config.gpgdir.c_str());
+    // libalpm copies the strings, the lists only live as long as the arena
+    alpm::list_arena arena{};
+    alpm_option_set_cachedirs(handle, arena.make_strings(config.cachedirs));
+    alpm_option_set_hookdirs(handle, arena.make_strings(config.hookdirs));
+    alpm_option_set_architectures(handle, arena.make_strings(config.architectures));
+    alpm_option_set_ignorepkgs(handle, arena.make_strings(config.ignorepkgs));
+    alpm_option_set_ignoregroups(handle, arena.make_strings(config.ignoregroups));
+    alpm_option_set_noupgrades(handle, arena.make_strings(config.noupgrade));
+    alpm_option_set_noextracts(handle, arena.make_strings(config.noextract));
+
+    alpm_option_set_default_siglevel(handle, config.siglevel);
+    alpm_option_set_local_file_siglevel(handle, config.local_file_siglevel);
+    alpm_option_set_remote_file_siglevel(handle, config.remote_file_siglevel);
+    alpm_option_set_parallel_downloads(handle, config.parallel_downloads);
+    alpm_option_set_checkspace(handle, config.checkspace);
+    alpm_option_set_usesyslog(handle, config.usesyslog);
+    alpm_option_set_disable_dl_timeout(handle, config.disable_download_timeout);
+
+    for (const auto& repo : config.repos) {
+        auto* db = alpm_register_syncdb(handle, repo.name.c_str(), repo.siglevel);
+        if (db == nullptr) {
+            spdlog::error("could not register '{}' database ({})", repo.name, alpm_strerror(alpm_errno(handle)));
             continue;
         }
-        auto* db = alpm_register_syncdb(handle, section.c_str(), ALPM_SIG_USE_DEFAULT);
-
-        for (const auto& it_nested : nested) {
-            const auto& param = it_nested.first;
-            const auto& value = it_nested.second;
-            if (param == "include") {
-                parse_includes(handle, db, section, value);
-            }
+        alpm_db_set_usage(db, repo.usage);
+        for (const auto& server : repo.servers) {
+            alpm_db_add_server(db, server.c_str());
         }
     }
 }
 }  // namespace
-}  // namespace utils
 
 namespace {
 /* prepare a list of pkgs to display */
@@ -348,39 +390,103 @@ std::string _display_targets(const std::vector<pm_target_t>& targets, bool verbo
 
 }  // namespace
 
-void setup_alpm(alpm_handle_t* handle) {
-    utils::parse_repos(handle);
-    utils::parse_cachedirs(handle);
+alpm_handle_t* init_alpm(alpm_errno_t* err, const std::string& conf_path) {
+    PROFILE_SCOPE("init_alpm");
+    const auto& config = PacmanConfig::load(conf_path);
+    if (!config) {
+        *err = ALPM_ERR_NOT_A_FILE;
+        return nullptr;
+    }
+
+    auto* handle = alpm_initialize(config->rootdir.c_str(), config->dbpath.c_str(), err);
+    if (handle == nullptr) {
+        spdlog::error("failed to initialize alpm library ({})", alpm_strerror(*err));
+        return nullptr;
+    }
+    apply_config(handle, *config);
+    bump_db_generation();
 
     alpm_option_set_logcb(handle, cb_log, nullptr);
     alpm_option_set_progresscb(handle, cb_progress, nullptr);
     alpm_option_set_eventcb(handle, cb_event, nullptr);
+    alpm_option_set_questioncb(handle, cb_question, nullptr);
+    return handle;
 }
 
 void destroy_alpm(alpm_handle_t* handle) {
+    if (handle == nullptr) {
+        return;
+    }
     alpm_unregister_all_syncdbs(handle);
     alpm_release(handle);
 }
 
-void refresh_alpm(alpm_handle_t** handle, alpm_errno_t* err) {
+void refresh_alpm(alpm_handle_t** handle, alpm_errno_t* err, const std::string& conf_path) {
     destroy_alpm(*handle);
-    *handle = alpm_initialize("/", "/var/lib/pacman/", err);
-    setup_alpm(*handle);
+    *handle = init_alpm(err, conf_path);
+}
+
+void set_db_lock_wait(std::chrono::milliseconds timeout, lock_wait_cb on_wait) {
+    g_db_lock_timeout = timeout;
+    g_db_lock_wait_cb = std::move(on_wait);
+}
+
+bool wait_for_db_lock(alpm_handle_t* handle) noexcept {
+    const std::string lockfile{alpm_option_get_lockfile(handle)};
+    if (access(lockfile.c_str(), F_OK) != 0) {
+        return true;
+    }
+    spdlog::info("waiting for another package manager to release {}", lockfile);
+    const auto start = std::chrono::steady_clock::now();
+    if (!wait_for_unlink(lockfile, g_db_lock_timeout, g_db_lock_wait_cb)) {
+        spdlog::error("error: gave up waiting for {}", lockfile);
+        return false;
+    }
+    const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    spdlog::info("{} released after {} ms", lockfile, waited.count());
+    return true;
+}
+
+int update_sync_dbs(alpm_handle_t* handle, std::vector<std::string>& changed_dbs, const db_progress_cb& progress_cb, bool force) {
+    auto* dbs = alpm_get_syncdbs(handle);
+    if (dbs == nullptr) {
+        spdlog::error("error: no usable package repositories configured.");
+        return -1;
+    }
+    if (!wait_for_db_lock(handle)) {
+        return -1;
+    }
+
+    db_update_ctx update_ctx{&progress_cb, &changed_dbs};
+    alpm_option_set_dlcb(handle, cb_db_download, &update_ctx);
+
+    // libalpm fetches all databases concurrently and drops the package cache
+    // of every refreshed database, so the handle does not need a re-init
+    const int ret = alpm_db_update(handle, dbs, force);
+    alpm_option_set_dlcb(handle, nullptr, nullptr);
+    if (ret < 0) {
+        spdlog::error("error: failed to synchronize databases ({})", alpm_strerror(alpm_errno(handle)));
+        return -1;
+    }
+
+    if (!changed_dbs.empty()) {
+        bump_db_generation();
+    }
+    spdlog::info("synchronized {} databases, {} changed", alpm_list_count(dbs), changed_dbs.size());
+    return 0;
 }
 
 std::string display_targets(alpm_handle_t* handle, bool verbosepkglists, std::string& status_text) {
     std::vector<pm_target_t> targets{};
     alpm_db_t* db_local = alpm_get_localdb(handle);
 
-    for (alpm_list_t* i = alpm_trans_get_add(handle); i; i = alpm_list_next(i)) {
-        auto* pkg = static_cast<alpm_pkg_t*>(i->data);
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_trans_get_add(handle)}) {
         pm_target_t targ;
         targ.install = pkg;
         targ.remove  = alpm_db_get_pkg(db_local, alpm_pkg_get_name(pkg));
         targets.emplace_back(targ);
     }
-    for (alpm_list_t* i = alpm_trans_get_remove(handle); i; i = alpm_list_next(i)) {
-        auto* pkg = static_cast<alpm_pkg_t*>(i->data);
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_trans_get_remove(handle)}) {
         pm_target_t targ;
         targ.install = nullptr;
         targ.remove  = pkg;
@@ -392,6 +498,15 @@ std::string display_targets(alpm_handle_t* handle, bool verbosepkglists, std::st
     return _display_targets(targets, verbosepkglists, status_text);
 }
 
+/* what the prepared transaction still has to fetch into the cache */
+static off_t trans_download_size(alpm_handle_t* handle) {
+    off_t dlsize{};
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_trans_get_add(handle)}) {
+        dlsize += alpm_pkg_download_size(pkg);
+    }
+    return dlsize;
+}
+
 void add_targets_to_install(alpm_handle_t* handle, const std::vector<std::string>& vec) {
     /* Step 0: create a new transaction */
     if (alpm_trans_init(handle, ALPM_TRANS_FLAG_ALLDEPS | ALPM_TRANS_FLAG_ALLEXPLICIT) != 0) {
@@ -401,11 +516,10 @@ void add_targets_to_install(alpm_handle_t* handle, const std::vector<std::string
     }
 
     /* Step 1: add targets to the created transaction */
-    auto* dbs = alpm_get_syncdbs(handle);
+    const alpm::list_view<alpm_db_t> dbs{alpm_get_syncdbs(handle)};
 
     for (const auto& el : vec) {
-        for (alpm_list_t* i = dbs; i != nullptr; i = i->next) {
-            auto* db  = reinterpret_cast<alpm_db_t*>(i->data);
+        for (auto* db : dbs) {
             auto* pkg = alpm_db_get_pkg(db, el.c_str());
             if (pkg) {
                 if (alpm_add_pkg(handle, pkg) != 0) {
@@ -459,10 +573,9 @@ static int trans_release(alpm_handle_t* handle) {
     return 0;
 }
 
-static alpm_db_t* get_db(alpm_handle_t* handle, const char* dbname) {
-    for (alpm_list_t* i = alpm_get_syncdbs(handle); i; i = i->next) {
-        auto* db = static_cast<alpm_db_t*>(i->data);
-        if (strcmp(alpm_db_get_name(db), dbname) == 0) {
+static alpm_db_t* get_db(alpm_handle_t* handle, std::string_view dbname) {
+    for (auto* db : alpm::list_view<alpm_db_t>{alpm_get_syncdbs(handle)}) {
+        if (alpm_db_get_name(db) == dbname) {
             return db;
         }
     }
@@ -479,9 +592,7 @@ static bool process_pkg(alpm_handle_t* handle, alpm_pkg_t* pkg) {
 }
 
 static bool group_exists(alpm_list_t* dbs, const char* name) {
-    for (alpm_list_t* i = dbs; i; i = i->next) {
-        auto* db = static_cast<alpm_db_t*>(i->data);
-
+    for (auto* db : alpm::list_view<alpm_db_t>{dbs}) {
         if (alpm_db_get_group(db, name)) {
             return true;
         }
@@ -491,10 +602,9 @@ static bool group_exists(alpm_list_t* dbs, const char* name) {
 }
 
 static int process_group(alpm_handle_t* handle, alpm_list_t* dbs, const char* group, int error) {
-    alpm_list_t* pkgs = alpm_find_group_pkgs(dbs, group);
-    size_t count      = alpm_list_count(pkgs);
+    const alpm::list<alpm_pkg_t> pkgs{alpm_find_group_pkgs(dbs, group)};
 
-    if (!count) {
+    if (pkgs.empty()) {
         if (group_exists(dbs, group)) {
             return 0;
         }
@@ -503,35 +613,37 @@ static int process_group(alpm_handle_t* handle, alpm_list_t* dbs, const char* gr
         return 1;
     }
 
-    int ret = 0;
     if (error) {
         /* we already know another target errored. there is no reason to prompt the
          * user here; we already validated the group name so just move on since we
          * won't actually be installing anything anyway. */
-        goto cleanup;
+        return 0;
     }
 
-    for (alpm_list_t* i = pkgs; i; i = alpm_list_next(i)) {
-        auto* pkg = static_cast<alpm_pkg_t*>(i->data);
-
+    for (auto* pkg : pkgs) {
         if (process_pkg(handle, pkg) == 1) {
-            ret = 1;
-            goto cleanup;
+            return 1;
         }
     }
-
-cleanup:
-    alpm_list_free(pkgs);
-    return ret;
+    return 0;
 }
 
 static int process_targname(alpm_handle_t* handle, alpm_list_t* dblist, const char* targname, int error) {
-    alpm_pkg_t* pkg = alpm_find_dbs_satisfier(handle, dblist, targname);
-
-    /* skip ignored packages when user says no */
-    if (alpm_errno(handle) == ALPM_ERR_PKG_IGNORED) {
-        spdlog::warn("skipping target: {}", targname);
-        return 0;
+    alpm_pkg_t* pkg{};
+    if (dblist == alpm_get_syncdbs(handle)) {
+        // plain targets are looked up in the index, libalpm would walk every package
+        pkg = PackageIndex::get(handle).find_sync_satisfier(targname);
+        // answered like cb_question answers libalpm, as pacman --noconfirm does
+        if (pkg != nullptr && alpm_pkg_should_ignore(handle, pkg)) {
+            spdlog::warn("{} is in IgnorePkg/IgnoreGroup, installing it anyway", alpm_pkg_get_name(pkg));
+        }
+    } else {
+        pkg = alpm_find_dbs_satisfier(handle, dblist, targname);
+        /* skip ignored packages when user says no */
+        if (!pkg && alpm_errno(handle) == ALPM_ERR_PKG_IGNORED) {
+            spdlog::warn("skipping target: {}", targname);
+            return 0;
+        }
     }
 
     if (pkg) {
@@ -542,44 +654,36 @@ static int process_targname(alpm_handle_t* handle, alpm_list_t* dblist, const ch
 }
 
 static int process_target(alpm_handle_t* handle, const char* target, int error) {
-    /* process targets */
-    char* targstring = strdup(target);
-    char* targname   = strchr(targstring, '/');
+    /* process targets, "repo/name" restricts the target to one database */
+    const std::string_view targstring{target};
+    const auto& slash = targstring.find('/');
     int ret{};
-    alpm_list_t* dblist;
 
-    if (targname && targname != targstring) {
-        *targname = '\0';
-        targname++;
-        const char* dbname = targstring;
-        alpm_db_t* db      = get_db(handle, dbname);
+    if (slash != std::string_view::npos && slash != 0) {
+        const auto& dbname   = targstring.substr(0, slash);
+        const char* targname = target + slash + 1;
+        alpm_db_t* db        = get_db(handle, dbname);
         if (!db) {
             spdlog::error("error: database not found: {}", dbname);
             ret = 1;
-            goto cleanup;
+        } else {
+            int usage;
+            /* explicitly mark this repo as valid for installs since
+             * a repo name was given with the target */
+            alpm_db_get_usage(db, &usage);
+            alpm_db_set_usage(db, usage | ALPM_DB_USAGE_INSTALL);
+
+            alpm::list_arena arena{};
+            ret = process_targname(handle, arena.make_single(db), targname, error);
+
+            /* restore old usage, so we don't possibly disturb later
+             * targets */
+            alpm_db_set_usage(db, usage);
         }
-
-        int usage;
-        /* explicitly mark this repo as valid for installs since
-         * a repo name was given with the target */
-        alpm_db_get_usage(db, &usage);
-        alpm_db_set_usage(db, usage | ALPM_DB_USAGE_INSTALL);
-
-        dblist = alpm_list_add(nullptr, db);
-        ret    = process_targname(handle, dblist, targname, error);
-        alpm_list_free(dblist);
-
-        /* restore old usage, so we don't possibly disturb later
-         * targets */
-        alpm_db_set_usage(db, usage);
     } else {
-        targname = targstring;
-        dblist   = alpm_get_syncdbs(handle);
-        ret      = process_targname(handle, dblist, targname, error);
+        ret = process_targname(handle, alpm_get_syncdbs(handle), target, error);
     }
 
-cleanup:
-    free(targstring);
     if (ret && access(target, R_OK) == 0) {
         spdlog::warn("'{}' is a file, did you mean {} instead of {}?", target, "-U/--upgrade", "-S/--sync");
     }
@@ -596,96 +700,148 @@ static int check_syncdbs(alpm_handle_t* handle, size_t need_repos) {
 }
 
 static int trans_init(alpm_handle_t* handle, int flags) {
-    int ret;
     check_syncdbs(handle, 0);
 
-    ret = alpm_trans_init(handle, flags);
-    if (ret == -1) {
-        trans_init_error(handle);
-        return -1;
+    // another package manager may grab the lock between the wait and the
+    // transaction, queue behind it again in that case
+    static constexpr int max_attempts = 3;
+    for (int attempt = 1;; ++attempt) {
+        if (!wait_for_db_lock(handle)) {
+            return -1;
+        }
+        if (alpm_trans_init(handle, flags) == 0) {
+            return 0;
+        }
+        if (alpm_errno(handle) != ALPM_ERR_HANDLE_LOCK || attempt == max_attempts) {
+            trans_init_error(handle);
+            return -1;
+        }
     }
-    return 0;
 }
 
 static void print_broken_dep(alpm_handle_t* handle, alpm_depmissing_t* miss) {
-    const std::string depstring = alpm_dep_compute_string(miss->depend);
-    alpm_list_t* trans_add      = alpm_trans_get_add(handle);
+    const alpm::unique_cstr depstring{alpm_dep_compute_string(miss->depend)};
+    alpm_list_t* trans_add = alpm_trans_get_add(handle);
     alpm_pkg_t* pkg;
     if (miss->causingpkg == nullptr) {
         /* package being installed/upgraded has unresolved dependency */
         spdlog::warn("unable to satisfy dependency '{}' required by {}",
-            depstring, miss->target);
+            depstring.get(), miss->target);
     } else if ((pkg = alpm_pkg_find(trans_add, miss->causingpkg))) {
         /* upgrading a package breaks a local dependency */
         spdlog::warn("installing {} ({}) breaks dependency '{}' required by {}",
-            miss->causingpkg, alpm_pkg_get_version(pkg), depstring, miss->target);
+            miss->causingpkg, alpm_pkg_get_version(pkg), depstring.get(), miss->target);
     } else {
         /* removing a package breaks a local dependency */
         spdlog::warn("removing {} breaks dependency '{}' required by {}",
-            miss->causingpkg, depstring, miss->target);
+            miss->causingpkg, depstring.get(), miss->target);
     }
 }
 
-static int sync_prepare_execute(alpm_handle_t* handle, std::string& conflict_msg) {
-    alpm_list_t *packages, *data = nullptr;
-    int retval{};
-
-    /* Step 2: "compute" the transaction based on targets and flags */
-    if (alpm_trans_prepare(handle, &data) == -1) {
+/* Step 2: "compute" the transaction based on targets and flags */
+static int trans_prepare(alpm_handle_t* handle, std::string& conflict_msg) {
+    alpm::list<void> data{};
+    if (alpm_trans_prepare(handle, data.put()) == -1) {
         alpm_errno_t err = alpm_errno(handle);
         spdlog::error("error: failed to prepare transaction ({})", alpm_strerror(err));
         switch (err) {
         case ALPM_ERR_PKG_INVALID_ARCH:
-            for (alpm_list_t* i = data; i; i = alpm_list_next(i)) {
-                const std::string pkg = static_cast<char*>(i->data);
+            for (const char* pkg : alpm::list<char, free>{data.release()}) {
                 spdlog::info("package {} does not have a valid architecture", pkg);
             }
             break;
         case ALPM_ERR_UNSATISFIED_DEPS:
-            for (alpm_list_t* i = data; i; i = alpm_list_next(i)) {
-                auto* miss = static_cast<alpm_depmissing_t*>(i->data);
+            for (auto* miss : alpm::list<alpm_depmissing_t, alpm_depmissing_free>{data.release()}) {
                 print_broken_dep(handle, miss);
-                alpm_depmissing_free(miss);
             }
             break;
 
         case ALPM_ERR_CONFLICTING_DEPS:
-            for (alpm_list_t* i = data; i; i = alpm_list_next(i)) {
-                auto* conflict = static_cast<alpm_conflict_t*>(i->data);
+            for (auto* conflict : alpm::list<alpm_conflict_t, alpm_conflict_free>{data.release()}) {
                 /* only print reason if it contains new information */
                 if (conflict->reason->mod == ALPM_DEP_MOD_ANY) {
                     conflict_msg += fmt::format("'{}' and '{}' are in conflict\n", conflict->package1, conflict->package2);
                     spdlog::info("'{}' and '{}' are in conflict", conflict->package1, conflict->package2);
                 } else {
-                    char* reason = alpm_dep_compute_string(conflict->reason);
+                    const alpm::unique_cstr reason{alpm_dep_compute_string(conflict->reason)};
                     if (reason == nullptr) {
                         conflict_msg += fmt::format("'{}' and '{}' are in conflict (null)\n", conflict->package1, conflict->package2);
                         spdlog::info("'{}' and '{}' are in conflict (null)", conflict->package1, conflict->package2);
                     } else {
-                        conflict_msg += fmt::format("'{}' and '{}' are in conflict ({})\n", conflict->package1, conflict->package2, reason);
-                        spdlog::info("'{}' and '{}' are in conflict ({})", conflict->package1, conflict->package2, reason);
-                        free(reason);
+                        conflict_msg += fmt::format("'{}' and '{}' are in conflict ({})\n", conflict->package1, conflict->package2, reason.get());
+                        spdlog::info("'{}' and '{}' are in conflict ({})", conflict->package1, conflict->package2, reason.get());
                     }
                 }
-                alpm_conflict_free(conflict);
             }
             break;
         default:
             break;
         }
-        retval = 1;
-        goto cleanup;
+        return 1;
     }
+    return 0;
+}
 
-    packages = alpm_trans_get_add(handle);
-    if (packages == nullptr) {
-        /* nothing to do: just exit without complaining */
-        goto cleanup;
+/* callback to record package downloads in the journal */
+static void cb_pkg_download(void* ctx, const char* filename, alpm_download_event_type_t event, void* data) {
+    (void)ctx;
+    if (event != ALPM_DOWNLOAD_COMPLETED) {
+        return;
     }
+    // result: 0 - downloaded, 1 - already up to date, -1 - failed
+    const auto* completed = static_cast<alpm_download_event_completed_t*>(data);
+    if (completed->result == 0) {
+        TransactionJournal::instance().downloaded(filename);
+    }
+}
+
+/* Step 3: actually perform the operation */
+static int trans_commit(alpm_handle_t* handle, std::string& error_msg) {
+    auto& journal = TransactionJournal::instance();
+    journal.begin(handle);
+
+    alpm::list<void> data{};
+    alpm_option_set_dlcb(handle, cb_pkg_download, nullptr);
+    const int ret = alpm_trans_commit(handle, data.put());
+    alpm_option_set_dlcb(handle, nullptr, nullptr);
+    journal.finish(ret == 0);
+
+    if (ret == -1) {
+        alpm_errno_t err = alpm_errno(handle);
+        spdlog::error("error: failed to commit transaction ({})", alpm_strerror(err));
+        error_msg += fmt::format("failed to commit transaction ({})\n", alpm_strerror(err));
+        switch (err) {
+        case ALPM_ERR_FILE_CONFLICTS:
+            for (auto* conflict : alpm::list<alpm_fileconflict_t, alpm_fileconflict_free>{data.release()}) {
+                if (conflict->type == ALPM_FILECONFLICT_TARGET) {
+                    error_msg += fmt::format("{} exists in both '{}' and '{}'\n", conflict->file, conflict->target, conflict->ctarget);
+                } else if (conflict->ctarget != nullptr && conflict->ctarget[0] != '\0') {
+                    error_msg += fmt::format("{}: {} exists in filesystem (owned by {})\n", conflict->target, conflict->file, conflict->ctarget);
+                } else {
+                    error_msg += fmt::format("{}: {} exists in filesystem\n", conflict->target, conflict->file);
+                }
+            }
+            break;
+        case ALPM_ERR_PKG_INVALID:
+        case ALPM_ERR_PKG_INVALID_CHECKSUM:
+        case ALPM_ERR_PKG_INVALID_SIG:
+            for (const char* filename : alpm::list<char, free>{data.release()}) {
+                error_msg += fmt::format("{} is invalid or corrupted\n", filename);
+            }
+            break;
+        default:
+            break;
+        }
+        spdlog::error("{}", error_msg);
+        return 1;
+    }
+    return 0;
+}
+
+static int sync_prepare_execute(alpm_handle_t* handle, std::string& conflict_msg) {
+    int retval = trans_prepare(handle, conflict_msg);
 
     /* Step 4: release transaction resources */
-cleanup:
-    alpm_list_free(data);
     if (trans_release(handle) == -1) {
         retval = 1;
     }
@@ -714,3 +870,261 @@ int sync_trans(alpm_handle_t* handle, const std::vector<std::string>& targets, i
 
     return sync_prepare_execute(handle, conflict_msg);
 }
+
+int commit_trans(alpm_handle_t* handle, const std::vector<std::string>& install, const std::vector<std::string>& remove, int flags, std::string& error_msg, bool dry_run) {
+    if (install.empty() && remove.empty()) {
+        return 0;
+    }
+
+    /* Step 1: create a new transaction... */
+    if (trans_init(handle, flags) == -1) {
+        error_msg = fmt::format("failed to init transaction ({})", alpm_strerror(alpm_errno(handle)));
+        return 1;
+    }
+
+    /* process targets */
+    int retval{};
+    for (auto&& targ : install) {
+        if (process_target(handle, targ.c_str(), retval) == 1) {
+            error_msg += fmt::format("target not found: {}\n", targ);
+            retval = 1;
+        }
+    }
+    /* packages which aren't installed need no removal */
+    auto* db_local = alpm_get_localdb(handle);
+    for (auto&& targ : remove) {
+        auto* pkg = alpm_db_get_pkg(db_local, targ.c_str());
+        if (pkg != nullptr && alpm_remove_pkg(handle, pkg) != 0) {
+            error_msg += fmt::format("failed to add package to be removed: {} ({})\n", targ, alpm_strerror(alpm_errno(handle)));
+            retval = 1;
+        }
+    }
+
+    /* Step 2: resolve dependencies and conflicts */
+    if (retval == 0) {
+        retval = trans_prepare(handle, error_msg);
+        if (retval != 0 && error_msg.empty()) {
+            error_msg = fmt::format("failed to prepare transaction ({})", alpm_strerror(alpm_errno(handle)));
+        }
+    }
+
+    if (retval == 0 && alpm_trans_get_add(handle) == nullptr && alpm_trans_get_remove(handle) == nullptr) {
+        spdlog::info(" there is nothing to do");
+    } else if (retval == 0) {
+        std::string status_text{};
+        const auto& details = display_targets(handle, false, status_text);
+        spdlog::info("Packages: {}\n{}", details, status_text);
+
+        /* Step 3: commit, unless the caller only wants to know what would happen */
+        if (!dry_run) {
+            retval = trans_commit(handle, error_msg);
+            // even a failed commit may have changed the local database
+            bump_db_generation();
+        }
+    }
+
+    /* Step 4: release transaction resources */
+    if (trans_release(handle) == -1) {
+        retval = 1;
+    }
+    return retval;
+}
+
+bool is_target_installed(alpm_handle_t* handle, const std::string& target) {
+    auto* localdb = alpm_get_localdb(handle);
+    if (alpm_db_get_pkg(localdb, target.c_str()) != nullptr) {
+        return true;
+    }
+    // provides, e.g. "sh", are only worth a walk once the name missed
+    if (alpm_find_satisfier(alpm_db_get_pkgcache(localdb), target.c_str()) != nullptr) {
+        return true;
+    }
+
+    /* a group counts as installed once every package it has in the sync databases is */
+    const alpm::list<alpm_pkg_t> pkgs{alpm_find_group_pkgs(alpm_get_syncdbs(handle), target.c_str())};
+    if (pkgs.empty()) {
+        return false;
+    }
+    return std::all_of(pkgs.begin(), pkgs.end(), [localdb](auto* pkg) { return alpm_db_get_pkg(localdb, alpm_pkg_get_name(pkg)) != nullptr; });
+}
+
+std::uint64_t db_generation() noexcept {
+    return g_db_generation.load(std::memory_order_relaxed);
+}
+
+void bump_db_generation() noexcept {
+    g_db_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+const trans_preview_t& TransPreviewCache::get(alpm_handle_t* handle, const std::vector<std::string>& targets, bool install) {
+    // any change of the databases invalidates every cached resolution
+    const auto generation = db_generation();
+    if (generation != m_generation) {
+        m_previews.clear();
+        m_generation = generation;
+    }
+
+    auto sorted_targets = targets;
+    std::sort(sorted_targets.begin(), sorted_targets.end());
+    sorted_targets.erase(std::unique(sorted_targets.begin(), sorted_targets.end()), sorted_targets.end());
+
+    std::string key{install ? "S" : "R"};
+    for (const auto& target : sorted_targets) {
+        key += '\n';
+        key += target;
+    }
+    if (auto it = m_previews.find(key); it != m_previews.end()) {
+        spdlog::debug("reusing resolution of {} targets", sorted_targets.size());
+        return it->second;
+    }
+
+    // waits for the database lock like a commit would
+    const int flags = install ? 0 : (ALPM_TRANS_FLAG_ALLDEPS | ALPM_TRANS_FLAG_ALLEXPLICIT);
+    if (trans_init(handle, flags) == -1) {
+        // e.g. the database is locked, not a property of the target set
+        m_failed = trans_preview_t{.conflict_msg = alpm_strerror(alpm_errno(handle)), .ok = false};
+        return m_failed;
+    }
+
+    trans_preview_t preview{};
+    int retval{};
+    if (install) {
+        for (const auto& targ : sorted_targets) {
+            if (process_target(handle, targ.c_str(), retval) == 1) {
+                retval = 1;
+            }
+        }
+        // dependencies are only pulled in by the prepare step
+        if (retval == 0) {
+            retval = trans_prepare(handle, preview.conflict_msg);
+        }
+    } else {
+        auto* db_local = alpm_get_localdb(handle);
+        for (const auto& targ : sorted_targets) {
+            auto* pkg = alpm_db_get_pkg(db_local, targ.c_str());
+            if (pkg != nullptr && alpm_remove_pkg(handle, pkg) != 0) {
+                preview.conflict_msg += fmt::format("failed to add package to be removed: {} ({})\n", targ, alpm_strerror(alpm_errno(handle)));
+                retval = 1;
+            }
+        }
+
+        // installed packages left with a missing dependency
+        const auto& index = PackageIndex::get(handle);
+        auto* removals    = alpm_trans_get_remove(handle);
+        for (auto* pkg : alpm::list_view<alpm_pkg_t>{removals}) {
+            for (auto* dependent : index.required_by(pkg)) {
+                if (alpm_pkg_find(removals, alpm_pkg_get_name(dependent)) == nullptr) {
+                    preview.summary += fmt::format("removing {} breaks {}\n", alpm_pkg_get_name(pkg), alpm_pkg_get_name(dependent));
+                }
+            }
+        }
+    }
+    preview.ok            = (retval == 0);
+    preview.details       = display_targets(handle, true, preview.summary);
+    preview.download_size = trans_download_size(handle);
+    trans_release(handle);
+
+    // only successful resolutions are worth keeping, a failure is retried next time
+    if (!preview.ok) {
+        m_failed = std::move(preview);
+        return m_failed;
+    }
+    return m_previews.emplace(std::move(key), std::move(preview)).first->second;
+}
+
+void TransPreviewCache::clear() noexcept {
+    m_previews.clear();
+}
+
+InstallPlan::~InstallPlan() {
+    release();
+}
+
+void InstallPlan::add_app(const std::string& name, const std::vector<std::string>& packages) {
+    for (const auto& pkgname : packages) {
+        if (m_seen.insert(pkgname).second) {
+            m_targets.emplace_back(pkgname);
+        }
+    }
+    m_apps.push_back({name, packages, false});
+}
+
+trans_preview_t InstallPlan::prepare(alpm_handle_t* handle, int flags, bool remove_conflicts) {
+    release();
+    m_outcomes.clear();
+
+    trans_preview_t preview{};
+    for (auto& app : m_apps) {
+        app.was_installed = std::all_of(app.packages.begin(), app.packages.end(),
+            [handle](auto&& target) { return is_target_installed(handle, target); });
+    }
+
+    /* Step 1: create a new transaction... */
+    if (trans_init(handle, flags) == -1) {
+        preview.conflict_msg = fmt::format("failed to init transaction ({})", alpm_strerror(alpm_errno(handle)));
+        preview.ok           = false;
+        return preview;
+    }
+    m_handle = handle;
+
+    for (const auto& targ : m_targets) {
+        if (process_target(handle, targ.c_str(), 0) == 1) {
+            preview.conflict_msg += fmt::format("target not found: {}\n", targ);
+            preview.ok = false;
+        }
+    }
+
+    /* Step 2: resolve everything at once, conflicts are only removed when asked to */
+    static bool remove_conflicts_ctx{true};
+    alpm_option_set_questioncb(handle, cb_question, remove_conflicts ? &remove_conflicts_ctx : nullptr);
+    if (preview.ok && trans_prepare(handle, preview.conflict_msg) != 0) {
+        preview.ok = false;
+    }
+    alpm_option_set_questioncb(handle, cb_question, nullptr);
+
+    if (!preview.ok) {
+        release();
+        return preview;
+    }
+    preview.details       = display_targets(handle, true, preview.summary);
+    preview.download_size = trans_download_size(handle);
+    return preview;
+}
+
+int InstallPlan::commit(std::string& error_msg) {
+    if (m_handle == nullptr) {
+        error_msg = "the transaction isn't prepared";
+        return 1;
+    }
+    auto* handle = m_handle;
+
+    /* Step 3: commit, unless everything is installed already */
+    int retval{};
+    if (alpm_trans_get_add(handle) != nullptr || alpm_trans_get_remove(handle) != nullptr) {
+        retval = trans_commit(handle, error_msg);
+        bump_db_generation();
+    }
+    release();
+
+    // the local database is up to date after a commit, even a failed one
+    m_outcomes.clear();
+    for (const auto& app : m_apps) {
+        auto outcome = AppOutcome::already_installed;
+        if (!app.was_installed) {
+            const bool installed = std::all_of(app.packages.begin(), app.packages.end(),
+                [handle](auto&& target) { return is_target_installed(handle, target); });
+            outcome = installed ? AppOutcome::installed : AppOutcome::failed;
+        }
+        m_outcomes.emplace_back(app.name, outcome);
+    }
+    return retval;
+}
+
+void InstallPlan::release() noexcept {
+    if (m_handle == nullptr) {
+        return;
+    }
+    /* Step 4: release transaction resources */
+    trans_release(m_handle);
+    m_handle = nullptr;
+}
@@ -17,21 +17,126 @@
 #ifndef ALPM_HELPER_HPP
 #define ALPM_HELPER_HPP
 
+#include "lockfile.hpp"
+
 #include <alpm.h>
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
-void setup_alpm(alpm_handle_t* handle);
+/* called with the database name and download percent, 100 once the database is done */
+using db_progress_cb = std::function<void(std::string_view dbname, int percent)>;
+
+inline constexpr auto pacman_conf_path = "/etc/pacman.conf";
+
+/* create a handle configured from pacman.conf, nullptr on failure */
+alpm_handle_t* init_alpm(alpm_errno_t* err, const std::string& conf_path = pacman_conf_path);
 void destroy_alpm(alpm_handle_t* handle);
-void refresh_alpm(alpm_handle_t** handle, alpm_errno_t* err);
+void refresh_alpm(alpm_handle_t** handle, alpm_errno_t* err, const std::string& conf_path = pacman_conf_path);
+
+/* transactions and database updates queue behind another package manager
+ * holding the database lock for up to timeout, on_wait is polled meanwhile */
+void set_db_lock_wait(std::chrono::milliseconds timeout, lock_wait_cb on_wait = {});
+bool wait_for_db_lock(alpm_handle_t* handle) noexcept;
+
+/* refresh every registered sync database in one go, names of the databases
+ * which actually changed are appended to changed_dbs */
+int update_sync_dbs(alpm_handle_t* handle, std::vector<std::string>& changed_dbs, const db_progress_cb& progress_cb = {}, bool force = false);
 
 int sync_trans(alpm_handle_t* handle, const std::vector<std::string>& targets, int flags, std::string& conflict_msg);
 
+/* resolve and commit install and remove targets in a single transaction,
+ * dry_run stops after printing what the transaction would do */
+int commit_trans(alpm_handle_t* handle, const std::vector<std::string>& install, const std::vector<std::string>& remove, int flags, std::string& error_msg, bool dry_run = false);
+
 std::string display_targets(alpm_handle_t* handle, bool verbosepkglists, std::string& status_text);
 
 void add_targets_to_install(alpm_handle_t* handle, const std::vector<std::string>& vec);
 
 void add_targets_to_remove(alpm_handle_t* handle, const std::vector<std::string>& vec);
 
+/* installed by name, provides, or every package of the group */
+bool is_target_installed(alpm_handle_t* handle, const std::string& target);
+
+/* generation of the database state, bumped on every handle re-init and
+ * whenever a database changes */
+std::uint64_t db_generation() noexcept;
+void bump_db_generation() noexcept;
+
+struct trans_preview_t {
+    std::string details{};       // packages to be installed/removed
+    std::string summary{};       // download and installed size totals
+    std::string conflict_msg{};  // why the transaction can't be prepared
+    off_t download_size{};
+    bool ok{true};
+};
+
+/* Resolves a transaction once per sorted target set and database
+ * generation, so confirming the same selection again is free. Only
+ * InstallPlan commits what it resolved, the GUI's single package
+ * install and removal still execute through pacman. */
+class TransPreviewCache final {
+ public:
+    const trans_preview_t& get(alpm_handle_t* handle, const std::vector<std::string>& targets, bool install);
+    void clear() noexcept;
+
+ private:
+    std::uint64_t m_generation{};
+    std::unordered_map<std::string, trans_preview_t> m_previews{};
+    trans_preview_t m_failed{};
+};
+
+enum class AppOutcome : std::uint8_t {
+    installed,
+    already_installed,
+    failed
+};
+
+/* Installs any number of apps with one resolve and one commit. The
+ * packages of all apps are merged into a single target set, the
+ * transaction stays open from prepare() until commit() or release(). */
+class InstallPlan final {
+ public:
+    InstallPlan() = default;
+    ~InstallPlan();
+    InstallPlan(const InstallPlan&)            = delete;
+    InstallPlan& operator=(const InstallPlan&) = delete;
+
+    void add_app(const std::string& name, const std::vector<std::string>& packages);
+
+    /* clang-format off */
+    auto targets() const noexcept -> const std::vector<std::string>&
+    { return m_targets; }
+    bool empty() const noexcept
+    { return m_targets.empty(); }
+    // one entry per app in the order added, filled by commit()
+    auto outcomes() const noexcept -> const std::vector<std::pair<std::string, AppOutcome>>&
+    { return m_outcomes; }
+    /* clang-format on */
+
+    trans_preview_t prepare(alpm_handle_t* handle, int flags, bool remove_conflicts = false);
+    int commit(std::string& error_msg);
+    void release() noexcept;
+
+ private:
+    struct app_t {
+        std::string name{};
+        std::vector<std::string> packages{};
+        bool was_installed{};
+    };
+
+    alpm_handle_t* m_handle{};  // set while the transaction is open
+    std::vector<app_t> m_apps{};
+    std::vector<std::string> m_targets{};
+    std::unordered_set<std::string> m_seen{};
+    std::vector<std::pair<std::string, AppOutcome>> m_outcomes{};
+};
+
 #endif  // ALPM_HELPER_HPP
@@ -0,0 +1,191 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef ALPMLIST_HPP
+#define ALPMLIST_HPP
+
+#include <alpm.h>
+#include <alpm_list.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+
+namespace alpm {
+
+// Forward iterator over the data pointers of an alpm_list_t chain.
+template <typename T>
+class list_iterator final {
+ public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = T*;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = T**;
+    using reference         = T*;
+
+    constexpr list_iterator() noexcept = default;
+    constexpr explicit list_iterator(const alpm_list_t* node) noexcept : m_node(node) { }
+
+    auto operator*() const noexcept -> T* { return static_cast<T*>(m_node->data); }
+    auto operator++() noexcept -> list_iterator& {
+        m_node = m_node->next;
+        return *this;
+    }
+    auto operator++(int) noexcept -> list_iterator {
+        auto tmp = *this;
+        ++*this;
+        return tmp;
+    }
+    constexpr bool operator==(const list_iterator&) const noexcept = default;
+
+ private:
+    const alpm_list_t* m_node{};
+};
+
+// Non-owning range over a list returned by libalpm,
+// e.g. `for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_trans_get_add(handle)})`.
+template <typename T>
+class list_view final {
+ public:
+    constexpr list_view() noexcept = default;
+    constexpr explicit list_view(alpm_list_t* list) noexcept : m_list(list) { }
+
+    auto begin() const noexcept -> list_iterator<T> { return list_iterator<T>{m_list}; }
+    auto end() const noexcept -> list_iterator<T> { return {}; }
+    auto get() const noexcept -> alpm_list_t* { return m_list; }
+    bool empty() const noexcept { return m_list == nullptr; }
+    auto size() const noexcept -> std::size_t { return alpm_list_count(m_list); }
+
+ private:
+    alpm_list_t* m_list{};
+};
+
+// Owning list, the nodes are freed on destruction and the data as well
+// when a free function is given, e.g. `alpm::list<char, free>`.
+template <typename T, auto FreeData = nullptr>
+class list final {
+ public:
+    constexpr list() noexcept = default;
+    constexpr explicit list(alpm_list_t* list) noexcept : m_list(list) { }
+    list(list&& other) noexcept : m_list(std::exchange(other.m_list, nullptr)) { }
+    auto operator=(list&& other) noexcept -> list& {
+        reset(std::exchange(other.m_list, nullptr));
+        return *this;
+    }
+    list(const list&)                    = delete;
+    auto operator=(const list&) -> list& = delete;
+    ~list() noexcept { reset(); }
+
+    auto begin() const noexcept -> list_iterator<T> { return list_iterator<T>{m_list}; }
+    auto end() const noexcept -> list_iterator<T> { return {}; }
+    auto get() const noexcept -> alpm_list_t* { return m_list; }
+    // out parameter for libalpm calls filling a list, e.g. alpm_trans_prepare
+    auto put() noexcept -> alpm_list_t** {
+        reset();
+        return &m_list;
+    }
+    auto release() noexcept -> alpm_list_t* { return std::exchange(m_list, nullptr); }
+    bool empty() const noexcept { return m_list == nullptr; }
+    auto size() const noexcept -> std::size_t { return alpm_list_count(m_list); }
+
+    void reset(alpm_list_t* list = nullptr) noexcept {
+        if (m_list != nullptr) {
+            if constexpr (FreeData != nullptr) {
+                alpm_list_free_inner(m_list, reinterpret_cast<alpm_list_fn_free>(FreeData));
+            }
+            alpm_list_free(m_list);
+        }
+        m_list = list;
+    }
+
+ private:
+    alpm_list_t* m_list{};
+};
+
+// Owns a malloc'ed string returned by libalpm, e.g. alpm_dep_compute_string.
+struct free_deleter {
+    void operator()(void* ptr) const noexcept { std::free(ptr); }
+};
+using unique_cstr = std::unique_ptr<char, free_deleter>;
+
+// Builds short-lived input lists for libalpm out of a monotonic arena, so a
+// list costs no malloc per node and everything is released at once.
+// The lists must only be passed to calls which copy them, never to ones
+// taking ownership (alpm_option_set_* and alpm_find_* copy).
+class list_arena final {
+ public:
+    list_arena() noexcept = default;
+    list_arena(const list_arena&)                    = delete;
+    auto operator=(const list_arena&) -> list_arena& = delete;
+
+    // list of the given pointers in order, nullptr for an empty range
+    template <typename Range, typename Proj>
+    auto make(const Range& range, Proj&& proj) -> alpm_list_t* {
+        alpm_list_t* head{};
+        for (const auto& item : range) {
+            append(head, const_cast<void*>(static_cast<const void*>(proj(item))));
+        }
+        return head;
+    }
+
+    // list of C strings, the strings themselves are not copied
+    template <typename Range>
+    auto make_strings(const Range& range) -> alpm_list_t* {
+        return make(range, [](const auto& str) { return str.c_str(); });
+    }
+
+    // single element list, e.g. the one database a target was restricted to
+    auto make_single(void* data) -> alpm_list_t* {
+        alpm_list_t* head{};
+        append(head, data);
+        return head;
+    }
+
+    // NUL-terminated copy of str owned by the arena
+    auto copy(std::string_view str) -> const char* {
+        auto* buf = static_cast<char*>(m_resource.allocate(str.size() + 1, alignof(char)));
+        str.copy(buf, str.size());
+        buf[str.size()] = '\0';
+        return buf;
+    }
+
+ private:
+    // keeps the libalpm invariant: head->prev points to the tail
+    void append(alpm_list_t*& head, void* data) {
+        auto* node = static_cast<alpm_list_t*>(m_resource.allocate(sizeof(alpm_list_t), alignof(alpm_list_t)));
+        node->data = data;
+        node->next = nullptr;
+        if (head == nullptr) {
+            node->prev = node;
+            head       = node;
+            return;
+        }
+        node->prev       = head->prev;
+        head->prev->next = node;
+        head->prev       = node;
+    }
+
+    alignas(alpm_list_t) std::byte m_buffer[2048]{};
+    std::pmr::monotonic_buffer_resource m_resource{m_buffer, sizeof(m_buffer)};
+};
+
+}  // namespace alpm
+
+#endif  // ALPMLIST_HPP
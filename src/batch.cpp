@@ -0,0 +1,206 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "batch.hpp"
+#include "alpmlist.hpp"
+#include "cacheprune.hpp"
+#include "catalog.hpp"
+#include "journal.hpp"
+#include "pkginfo.hpp"
+#include "profile.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string_view>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+std::optional<BatchOptions> parse_batch_args(int argc, char** argv) {
+    BatchOptions options{};
+    bool batch_mode{};
+    bool in_app_list{};
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        const bool has_value = (i + 1 < argc);
+        if (arg == "--batch") {
+            batch_mode  = true;
+            in_app_list = true;
+            continue;
+        }
+        if (!arg.starts_with("-") && in_app_list) {
+            options.apps.emplace_back(arg);
+            continue;
+        }
+
+        in_app_list = false;
+        if (arg == "--apply" && has_value) {
+            batch_mode      = true;
+            options.profile = argv[++i];
+        } else if (arg == "--catalog" && has_value) {
+            options.catalog = argv[++i];
+        } else if (arg == "--config" && has_value) {
+            options.conf_path = argv[++i];
+        } else if (arg == "--refresh") {
+            options.refresh = true;
+        } else if (arg == "--dry-run") {
+            options.dry_run = true;
+        } else if (arg == "--rollback") {
+            batch_mode       = true;
+            options.rollback = true;
+        } else if (arg == "--prune-cache") {
+            batch_mode          = true;
+            options.prune_cache = true;
+        } else if (arg == "--profile" || arg.starts_with("--profile=")) {
+            // only the GUI startup is profiled
+            continue;
+        } else {
+            options.unknown_args.emplace_back(arg);
+        }
+    }
+
+    if (!batch_mode) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+namespace {
+// keeps the newest versions of every cached package, as the Clean up button does
+void prune_package_cache(alpm_handle_t* handle, bool dry_run) {
+    std::vector<std::string> cachedirs{};
+    for (const char* cachedir : alpm::list_view<char>{alpm_option_get_cachedirs(handle)}) {
+        cachedirs.emplace_back(cachedir);
+    }
+    PackageCacheIndex cache_index(std::move(cachedirs));
+    cache_index.scan();
+    const auto& report = cache_index.plan(default_keep_versions);
+    spdlog::info("cache: {} old versions take {}", report.packages, format_size(report.reclaimable_size));
+    PackageCacheIndex::remove(report, dry_run);
+}
+}  // namespace
+
+int run_batch(const BatchOptions& options) {
+    for (const auto& arg : options.unknown_args) {
+        spdlog::error("unknown or incomplete option: {}", arg);
+    }
+    if (!options.unknown_args.empty()) {
+        return EXIT_FAILURE;
+    }
+    if (getuid() != 0) {
+        spdlog::error("batch mode has to be run as root");
+        return EXIT_FAILURE;
+    }
+
+    // queue behind another instance or package manager, telling why every few seconds
+    const auto& report_wait = [](std::string_view what) {
+        return [what = std::string{what}, reported = std::chrono::milliseconds{-1}](std::chrono::milliseconds waited) mutable {
+            if (reported.count() < 0 || waited - reported >= std::chrono::seconds{5}) {
+                spdlog::info("waiting for {} ({} s)", what, waited.count() / 1000);
+                reported = waited;
+            }
+            return true;
+        };
+    };
+    LockFile instance_lock(instance_lock_path);
+    if (!instance_lock.lock() && !instance_lock.lock(std::chrono::minutes{10}, report_wait(fmt::format("cachyos-pi (pid {})", instance_lock.holder())))) {
+        spdlog::error("another instance is still running");
+        return EXIT_FAILURE;
+    }
+    set_db_lock_wait(std::chrono::minutes{10}, report_wait("another package manager"));
+
+    Profile profile{};
+    if (!options.profile.empty()) {
+        auto loaded = Profile::load(options.profile);
+        if (!loaded) {
+            return EXIT_FAILURE;
+        }
+        profile = std::move(*loaded);
+    }
+    profile.apps.insert(profile.apps.end(), options.apps.begin(), options.apps.end());
+    const bool has_requests = !(profile.apps.empty() && profile.packages.empty() && profile.remove.empty());
+    const auto& pending     = TransactionJournal::instance().pending();
+    if (!has_requests && !pending && !options.prune_cache) {
+        spdlog::info(options.rollback ? "there is no interrupted transaction to roll back" : "no apps requested, there is nothing to do");
+        return EXIT_SUCCESS;
+    }
+
+    // the local copy of the catalog is enough unless it lacks a requested app,
+    // re-applying a profile shouldn't wait for the network
+    const auto& local_catalog = options.catalog.empty() ? std::string{catalog_path} : options.catalog;
+    auto catalog              = load_catalog(local_catalog);
+    const bool missing_apps   = std::any_of(profile.apps.begin(), profile.apps.end(),
+          [&catalog](auto&& app) { return find_app(catalog, app) == nullptr; });
+    if (options.catalog.empty() && missing_apps && update_catalog()) {
+        catalog = load_catalog(local_catalog);
+    }
+
+    alpm_errno_t err{};
+    auto* handle = init_alpm(&err, options.conf_path);
+    if (handle == nullptr) {
+        spdlog::error("failed to initialize alpm library ({})", alpm_strerror(err));
+        return EXIT_FAILURE;
+    }
+
+    if (options.refresh) {
+        std::vector<std::string> changed_dbs{};
+        if (update_sync_dbs(handle, changed_dbs) != 0) {
+            destroy_alpm(handle);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // an interrupted transaction is finished first, unless asked to undo it,
+    // a dry run only reports it
+    if (pending && options.dry_run) {
+        spdlog::info("an interrupted transaction would be {} first: installing {} and removing {} packages",
+            options.rollback ? "rolled back" : "resumed", pending->added.size() + pending->upgraded.size(), pending->removed.size());
+    } else if (pending) {
+        std::string error_msg{};
+        const auto action = options.rollback ? RecoveryAction::rollback : RecoveryAction::resume;
+        if (recover_transaction(handle, *pending, action, error_msg) != 0) {
+            spdlog::error("recovering the interrupted transaction failed: {}", error_msg);
+            destroy_alpm(handle);
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.prune_cache) {
+        prune_package_cache(handle, options.dry_run);
+    }
+    if (!has_requests || options.rollback) {
+        destroy_alpm(handle);
+        return EXIT_SUCCESS;
+    }
+
+    const auto& diff = diff_profile(handle, profile, catalog);
+    if (diff.empty()) {
+        spdlog::info("the system already matches, there is nothing to do");
+        destroy_alpm(handle);
+        return EXIT_SUCCESS;
+    }
+
+    std::string error_msg{};
+    const int ret = commit_trans(handle, diff.install, diff.remove, ALPM_TRANS_FLAG_NEEDED, error_msg, options.dry_run);
+    destroy_alpm(handle);
+    if (ret != 0) {
+        spdlog::error("applying the changes failed: {}", error_msg);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
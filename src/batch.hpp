@@ -0,0 +1,45 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "alpm_helper.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+struct BatchOptions {
+    std::vector<std::string> apps{};  // catalog apps, anything else is taken as a package name
+    std::string profile{};            // --apply
+    std::string catalog{};            // --catalog, skips downloading the catalog
+    std::string conf_path{pacman_conf_path};
+    bool refresh{};  // --refresh, synchronize the databases first
+    bool dry_run{};  // --dry-run, print the transaction without committing it
+    bool rollback{}; // --rollback, undo an interrupted transaction instead of resuming it
+    bool prune_cache{};  // --prune-cache, drop old versions from the package cache
+    std::vector<std::string> unknown_args{};
+};
+
+// std::nullopt unless the command line asks for --batch, --apply, --rollback or --prune-cache.
+std::optional<BatchOptions> parse_batch_args(int argc, char** argv);
+
+// Brings the system in line with the requested apps and profile in a
+// single transaction without any UI, returns the exit status of the process.
+int run_batch(const BatchOptions& options);
+
+#endif  // BATCH_HPP
@@ -0,0 +1,165 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "cacheprune.hpp"
+#include "systeminfo.hpp"
+
+#include <alpm.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+auto PackageCacheIndex::parse_filename(std::string_view filename) noexcept -> std::optional<CachedPackage> {
+    const auto& ext = filename.find(".pkg.tar");
+    if (ext == std::string_view::npos || filename.ends_with(".sig") || filename.ends_with(".part")) {
+        return std::nullopt;
+    }
+
+    // name may contain dashes, the last three fields never do
+    std::string_view rest = filename.substr(0, ext);
+    std::string_view fields[3]{};
+    for (auto& field : fields) {
+        const auto& dash = rest.rfind('-');
+        if (dash == std::string_view::npos || dash == 0) {
+            return std::nullopt;
+        }
+        field = rest.substr(dash + 1);
+        rest  = rest.substr(0, dash);
+    }
+
+    CachedPackage pkg{};
+    pkg.name    = rest;
+    pkg.version = fmt::format("{}-{}", fields[2], fields[1]);
+    pkg.arch    = fields[0];
+    return pkg;
+}
+
+void PackageCacheIndex::scan() {
+    m_packages.clear();
+    for (const auto& cachedir : m_cachedirs) {
+        // iterated by hand, operator++ would throw on a read error
+        std::error_code err{};
+        for (fs::directory_iterator it{cachedir, err}, end{}; !err && it != end; it.increment(err)) {
+            const auto& entry = *it;
+            std::error_code entry_err{};
+            if (!entry.is_regular_file(entry_err)) {
+                continue;
+            }
+            auto pkg = parse_filename(entry.path().filename().native());
+            if (!pkg) {
+                continue;
+            }
+            pkg->path = entry.path().native();
+            pkg->size = static_cast<off_t>(entry.file_size(entry_err));
+
+            const auto& sig_path = pkg->path + ".sig";
+            if (::access(sig_path.c_str(), F_OK) == 0) {
+                pkg->has_sig = true;
+                pkg->size += static_cast<off_t>(fs::file_size(sig_path, entry_err));
+            }
+            m_packages.emplace_back(std::move(*pkg));
+        }
+        if (err) {
+            spdlog::warn("cache: could not read '{}': {}", cachedir, err.message());
+        }
+    }
+    spdlog::debug("cache: indexed {} packages", m_packages.size());
+}
+
+auto PackageCacheIndex::plan(std::size_t keep_versions) const -> PruneReport {
+    std::unordered_map<std::string, std::vector<const CachedPackage*>> by_package{};
+    for (const auto& pkg : m_packages) {
+        by_package[pkg.name + '\n' + pkg.arch].push_back(&pkg);
+    }
+
+    PruneReport report{};
+    const auto& drop = [&report](const CachedPackage* pkg) {
+        report.files.push_back(pkg->path);
+        if (pkg->has_sig) {
+            report.files.push_back(pkg->path + ".sig");
+        }
+        ++report.packages;
+        report.reclaimable_size += pkg->size;
+    };
+
+    for (auto& [key, versions] : by_package) {
+        // newest first, of duplicates the signed copy is kept
+        std::sort(versions.begin(), versions.end(), [](const auto* lhs, const auto* rhs) {
+            const int cmp = alpm_pkg_vercmp(lhs->version.c_str(), rhs->version.c_str());
+            return (cmp != 0) ? cmp > 0 : lhs->has_sig > rhs->has_sig;
+        });
+
+        std::size_t kept{};
+        const std::string* last_version{};
+        for (const auto* pkg : versions) {
+            // the same version with another compression is a duplicate
+            if (last_version != nullptr && *last_version == pkg->version) {
+                drop(pkg);
+                continue;
+            }
+            last_version = &pkg->version;
+            if (kept < keep_versions) {
+                ++kept;
+                continue;
+            }
+            drop(pkg);
+        }
+    }
+    return report;
+}
+
+std::size_t PackageCacheIndex::remove(const PruneReport& report, bool dry_run) {
+    if (dry_run) {
+        for (const auto& file : report.files) {
+            spdlog::info("cache: would remove {}", file);
+        }
+        return report.files.size();
+    }
+
+    // unlink is bound by metadata updates, a few workers hide the latency
+    const auto worker_count = std::clamp<std::size_t>(SystemInfo::instance().core_count(), 1, 8);
+    std::atomic<std::size_t> next{};
+    std::atomic<std::size_t> removed{};
+    const auto& worker = [&] {
+        for (auto i = next++; i < report.files.size(); i = next++) {
+            if (::unlink(report.files[i].c_str()) == 0) {
+                ++removed;
+            } else {
+                spdlog::warn("cache: could not remove '{}'", report.files[i]);
+            }
+        }
+    };
+
+    std::vector<std::jthread> workers{};
+    workers.reserve(worker_count - 1);
+    for (std::size_t i = 1; i < worker_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    workers.clear();
+
+    spdlog::info("cache: removed {} files", removed.load());
+    return removed.load();
+}
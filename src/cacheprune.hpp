@@ -0,0 +1,71 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef CACHEPRUNE_HPP
+#define CACHEPRUNE_HPP
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CachedPackage {
+    std::string path{};
+    std::string name{};
+    std::string version{};  // pkgver-pkgrel, with epoch if any
+    std::string arch{};
+    off_t size{};           // including the signature
+    bool has_sig{};
+};
+
+// paccache keeps three versions by default as well
+inline constexpr std::size_t default_keep_versions = 3;
+
+struct PruneReport {
+    std::vector<std::string> files{};  // packages and their signatures
+    std::size_t packages{};
+    off_t reclaimable_size{};
+};
+
+// Index of the package cache directories, built from file names alone so
+// no package has to be opened. Like paccache it keeps the most recent
+// versions of each package and drops the rest, copies of the same version
+// with another compression count as duplicates.
+class PackageCacheIndex final {
+ public:
+    explicit PackageCacheIndex(std::vector<std::string> cachedirs) : m_cachedirs(std::move(cachedirs)) { }
+
+    void scan();
+    auto packages() const noexcept -> const std::vector<CachedPackage>& { return m_packages; }
+
+    // what keeping the given number of versions per package would remove
+    auto plan(std::size_t keep_versions) const -> PruneReport;
+    // deletes the planned files in parallel, returns how many were removed;
+    // a dry run only logs them
+    static std::size_t remove(const PruneReport& report, bool dry_run = false);
+
+    // "name-pkgver-pkgrel-arch.pkg.tar.zst" split into its parts
+    static auto parse_filename(std::string_view filename) noexcept -> std::optional<CachedPackage>;
+
+ private:
+    std::vector<std::string> m_cachedirs{};
+    std::vector<CachedPackage> m_packages{};
+};
+
+#endif  // CACHEPRUNE_HPP
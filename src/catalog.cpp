@@ -0,0 +1,132 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#pragma clang diagnostic ignored "-Wshadow"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wshadow"
+#endif
+
+#include <ryml_std.hpp>
+#include <ryml.hpp>
+#include <cpr/cpr.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include "catalog.hpp"
+#include "profiler.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+std::string get_node_key(const ryml::NodeRef& node) {
+    std::string key{};
+    if (node.has_key() && !node.has_key_tag()) {
+        key = std::string{node.key().str, node.key().len};
+    }
+    return key;
+}
+
+// every line of a package list is one app, named by its first package
+void add_apps(std::vector<CatalogEntry>& catalog, const std::string& group, const std::string& category, const ryml::NodeRef& node) {
+    for (const ryml::NodeRef& pkg_list : node.children()) {
+        if (!pkg_list.has_val() || pkg_list.has_val_tag()) {
+            continue;
+        }
+        auto names = ::utils::make_multiline(std::string_view{pkg_list.val().str, pkg_list.val().len}, false, " ");
+        if (names.empty()) {
+            continue;
+        }
+        catalog.push_back({group, category, names[0], std::move(names)});
+    }
+}
+
+void add_group(std::vector<CatalogEntry>& catalog, const std::string& parent_category, const ryml::NodeRef& node) {
+    for (const ryml::NodeRef& map : node.children()) {
+        std::string category{};
+        for (const ryml::NodeRef& map_child : map.children()) {
+            if (map_child.has_val() && !map_child.has_val_tag()) {
+                category = std::string{map_child.val().str, map_child.val().len};
+            }
+            if (map_child.is_container()) {
+                add_apps(catalog, parent_category, category, map_child);
+            }
+        }
+    }
+}
+}  // namespace
+
+bool update_catalog(const std::string& url, const std::string& path) {
+    PROFILE_SCOPE("update_catalog");
+    const cpr::Response r = cpr::Get(cpr::Url{url});
+    if (r.error.code != cpr::ErrorCode::OK || r.status_code != 200) {
+        spdlog::warn("Could not download the app catalog: {}", r.error.message);
+        return false;
+    }
+
+    std::ofstream pkglistyaml{path};
+    pkglistyaml << r.text;
+    return static_cast<bool>(pkglistyaml);
+}
+
+std::vector<CatalogEntry> load_catalog(const std::string& path) {
+    PROFILE_SCOPE("load_catalog");
+    std::ifstream file{path};
+    if (!file.is_open()) {
+        spdlog::error("Could not open: {}", path);
+        return {};
+    }
+    const std::string src{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    ryml::Tree tree    = ryml::parse_in_arena(ryml::to_csubstr(src));
+    ryml::NodeRef root = tree.rootref();
+
+    std::vector<CatalogEntry> catalog{};
+    for (const ryml::NodeRef& map : root.children()) {
+        std::string category{};
+        for (const ryml::NodeRef& map_child : map.children()) {
+            if (map_child.has_val() && !map_child.has_val_tag()) {
+                category = std::string{map_child.val().str, map_child.val().len};
+            }
+            if (!map_child.is_container()) {
+                continue;
+            }
+            if (get_node_key(map_child) == "subgroups") {
+                add_group(catalog, category, map_child);
+            } else {
+                add_apps(catalog, category, category, map_child);
+            }
+        }
+    }
+    return catalog;
+}
+
+const CatalogEntry* find_app(const std::vector<CatalogEntry>& catalog, std::string_view name) noexcept {
+    const auto it = std::find_if(catalog.begin(), catalog.end(), [name](auto&& entry) { return entry.name == name; });
+    return (it != catalog.end()) ? &*it : nullptr;
+}
@@ -0,0 +1,44 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+inline constexpr auto catalog_url  = "https://raw.githubusercontent.com/xerolinux/xero-piai/main/pkglist.yaml";
+inline constexpr auto catalog_path = "/usr/lib/xero-piai/pkglist.yaml";
+
+struct CatalogEntry {
+    std::string group{};
+    std::string category{};
+    std::string name{};                   // the app, also its first package
+    std::vector<std::string> packages{};  // everything installed along with the app
+};
+
+// Replaces the catalog at path with the latest published one,
+// the old copy is kept if the download fails.
+bool update_catalog(const std::string& url = catalog_url, const std::string& path = catalog_path);
+
+// Apps listed by the catalog at path, in file order. Empty if the file
+// can't be read.
+std::vector<CatalogEntry> load_catalog(const std::string& path = catalog_path);
+
+const CatalogEntry* find_app(const std::vector<CatalogEntry>& catalog, std::string_view name) noexcept;
+
+#endif  // CATALOG_HPP
@@ -0,0 +1,49 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "batch.hpp"
+
+#include <cstdlib>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+// Entry point of the batch installer, links nothing from Qt.
+int main(int argc, char* argv[]) {
+    const auto& options = parse_batch_args(argc, argv);
+    if (!options) {
+        fmt::print(stderr,
+            "usage: {0} --batch <app>... [options]\n"
+            "       {0} --apply <profile.yaml> [options]\n"
+            "       {0} --rollback\n"
+            "\n"
+            "options:\n"
+            "  --catalog <path>  use a local app catalog instead of downloading it\n"
+            "  --config <path>   pacman configuration file (default: {1})\n"
+            "  --refresh         synchronize package databases first\n"
+            "  --dry-run         only print what would be done\n"
+            "\n"
+            "An interrupted transaction is resumed before anything else,\n"
+            "--rollback undoes it instead.\n",
+            argv[0], pacman_conf_path);
+        return EXIT_FAILURE;
+    }
+
+    spdlog::set_pattern("[%^%l%$] %v");
+    const int status_code = run_batch(*options);
+    spdlog::shutdown();
+    return status_code;
+}
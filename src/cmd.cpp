@@ -9,8 +9,14 @@ Cmd::Cmd(QObject* parent)
   : QProcess(parent) {
     connect(this, &Cmd::readyReadStandardOutput, [&]() { emit outputAvailable(readAllStandardOutput()); });
     connect(this, &Cmd::readyReadStandardError, [&]() { emit errorAvailable(readAllStandardError()); });
-    connect(this, &Cmd::outputAvailable, [&](const QString& out) { out_buffer += out; });
-    connect(this, &Cmd::errorAvailable, [&](const QString& out) { out_buffer += out; });
+    connect(this, &Cmd::outputAvailable, [&](const QString& out) {
+        if (m_capture)
+            out_buffer += out;
+    });
+    connect(this, &Cmd::errorAvailable, [&](const QString& out) {
+        if (m_capture)
+            out_buffer += out;
+    });
 }
 
 void Cmd::halt() {
@@ -23,21 +29,21 @@ void Cmd::halt() {
 }
 
 bool Cmd::run(const QString& cmd, bool quiet) {
-    out_buffer.clear();
-    QString output;
-    return run(cmd, output, quiet);
+    return execute(cmd, nullptr, quiet);
 }
 
 // util function for getting bash command output
 QString Cmd::getCmdOut(const QString& cmd, bool quiet) {
-    out_buffer.clear();
     QString output;
-    run(cmd, output, quiet);
+    execute(cmd, &output, quiet);
     return output;
 }
 
 bool Cmd::run(const QString& cmd, QString& output, bool quiet) {
-    out_buffer.clear();
+    return execute(cmd, &output, quiet);
+}
+
+bool Cmd::execute(const QString& cmd, QString* output, bool quiet) {
     connect(this, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &Cmd::finished, Qt::UniqueConnection);
     if (this->state() != QProcess::NotRunning) {
         std::vector<std::string> args_vec(size_t(this->arguments().size()));
@@ -47,12 +53,99 @@ bool Cmd::run(const QString& cmd, QString& output, bool quiet) {
         spdlog::debug("Process already running:{},{}", this->program().toStdString(), fmt::join(args_vec, ", "));
         return false;
     }
+    out_buffer.clear();
+    m_capture = (output != nullptr);
     if (!quiet)
         spdlog::debug("{}", cmd.toStdString().data());
+    // the user answers prompts from the output tab while the command runs,
+    // non-interactive commands go through CmdTask instead
     QEventLoop loop;
     connect(this, &Cmd::finished, &loop, &QEventLoop::quit);
     start("/bin/bash", QStringList() << "-c" << cmd);
     loop.exec();
-    output = out_buffer.trimmed();
+    m_capture = false;
+    if (output != nullptr) {
+        *output = out_buffer.trimmed();
+        out_buffer.clear();
+    }
     return (exitStatus() == QProcess::NormalExit && exitCode() == 0);
 }
+
+CmdTask::CmdTask(const QString& cmd, QObject* parent, int timeout_ms)
+  : QObject(parent), m_timeout_ms(timeout_ms) {
+    connect(&m_process, &QProcess::readyReadStandardOutput, this, &CmdTask::readOutput);
+    connect(&m_process, &QProcess::readyReadStandardError, this, [this]() {
+        spdlog::warn("{}", QString(m_process.readAllStandardError()).trimmed().toStdString());
+    });
+    connect(&m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &CmdTask::onFinished);
+    connect(&m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            onFinished(-1, QProcess::CrashExit);
+        }
+    });
+
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &CmdTask::onTimeout);
+
+    // deferred, so finished() can't fire before the caller connected to it
+    QTimer::singleShot(0, this, [this, cmd]() {
+        if (m_timeout_ms > 0) {
+            m_timer.start(m_timeout_ms);
+        }
+        m_process.start("/bin/bash", QStringList() << "-c" << cmd);
+    });
+}
+
+CmdTask* CmdTask::start(const QString& cmd, QObject* parent, int timeout_ms, bool quiet) {
+    if (!quiet)
+        spdlog::debug("{}", cmd.toStdString().data());
+    return new CmdTask(cmd, parent, timeout_ms);
+}
+
+CmdTask* CmdTask::then(continuation_t continuation) {
+    m_continuation = std::move(continuation);
+    return this;
+}
+
+void CmdTask::readOutput() {
+    m_partial += QString(m_process.readAllStandardOutput());
+    int newline_at{};
+    while ((newline_at = m_partial.indexOf(QLatin1Char('\n'))) != -1) {
+        const QString line = m_partial.left(newline_at);
+        m_partial.remove(0, newline_at + 1);
+        m_result.output += line + QLatin1Char('\n');
+        emit lineAvailable(line);
+    }
+}
+
+void CmdTask::onFinished(int exit_code, QProcess::ExitStatus exit_status) {
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    m_timer.stop();
+
+    readOutput();
+    if (!m_partial.isEmpty()) {
+        m_result.output += m_partial;
+        emit lineAvailable(m_partial);
+        m_partial.clear();
+    }
+    m_result.output    = m_result.output.trimmed();
+    m_result.exit_code = exit_code;
+    m_result.crashed   = (exit_status == QProcess::CrashExit) && !m_result.timed_out;
+
+    emit finished(m_result);
+    if (m_continuation) {
+        auto continuation = std::move(m_continuation);
+        continuation(m_result);
+    }
+    deleteLater();
+}
+
+// the kill is reaped through finished(), until then the task stays alive
+void CmdTask::onTimeout() {
+    spdlog::warn("command timed out after {}ms: {}", m_timeout_ms, m_process.arguments().join(" ").toStdString());
+    m_result.timed_out = true;
+    m_process.kill();
+}
@@ -1,9 +1,13 @@
 #ifndef CMD_HPP
 #define CMD_HPP
 
+#include <functional>
+
 #include <QProcess>
 #include <QString>
+#include <QTimer>
 
+// Interactive console process, its stdin is driven by the user from the output tab.
 class Cmd : public QProcess {
     Q_OBJECT
  public:
@@ -20,7 +24,58 @@ class Cmd : public QProcess {
     void outputAvailable(const QString& out);
 
  private:
+    bool execute(const QString& cmd, QString* output, bool quiet);
+
+    // only filled while a caller waits for the command output
     QString out_buffer{};
+    bool m_capture{};
+};
+
+struct CmdResult {
+    int exit_code{-1};
+    bool crashed{};
+    bool timed_out{};
+    QString output{};  // stdout, stderr is logged
+
+    [[nodiscard]] bool ok() const noexcept { return !crashed && !timed_out && exit_code == 0; }
+};
+
+// Non-interactive command in its own process, any number of them may run at
+// the same time and none blocks the caller. Output arrives line by line via
+// lineAvailable(), the result via finished() or the continuation passed to
+// then(). The process starts once the event loop runs again, so handlers can
+// be attached after start(). The task deletes itself once finished, deleting
+// the parent earlier kills the command.
+class CmdTask final : public QObject {
+    Q_OBJECT
+ public:
+    using continuation_t = std::function<void(const CmdResult& result)>;
+
+    // timeout_ms <= 0 lets the command run until it exits
+    static CmdTask* start(const QString& cmd, QObject* parent, int timeout_ms = -1, bool quiet = false);
+
+    // called from the event loop once the command finished
+    CmdTask* then(continuation_t continuation);
+
+ signals:
+    void lineAvailable(const QString& line);
+    void finished(const CmdResult& result);
+
+ private:
+    CmdTask(const QString& cmd, QObject* parent, int timeout_ms);
+
+    void readOutput();
+    void onFinished(int exit_code, QProcess::ExitStatus exit_status);
+    void onTimeout();
+
+    QProcess m_process{};
+    QTimer m_timer{};
+    int m_timeout_ms{};
+
+    continuation_t m_continuation{};
+    QString m_partial{};
+    CmdResult m_result{};
+    bool m_done{};
 };
 
 #endif  // CMD_HPP
@@ -0,0 +1,132 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "depclosure.hpp"
+#include "alpm_helper.hpp"
+#include "alpmlist.hpp"
+#include "pkgindex.hpp"
+#include "pkginfo.hpp"
+
+#include <unordered_set>
+
+namespace {
+// sync package satisfying dep, nullptr if the local database already does
+alpm_pkg_t* find_missing_dep(const PackageIndex& index, const alpm_depend_t* dep) noexcept {
+    if (index.find_local_satisfier(dep) != nullptr) {
+        return nullptr;
+    }
+    return index.find_sync_satisfier(dep);
+}
+
+// installs use ALPM_TRANS_FLAG_NEEDED, which skips targets installed at the sync version
+bool is_up_to_date(alpm_db_t* localdb, alpm_pkg_t* pkg) noexcept {
+    auto* local_pkg = alpm_db_get_pkg(localdb, alpm_pkg_get_name(pkg));
+    return local_pkg != nullptr && alpm_pkg_vercmp(alpm_pkg_get_version(local_pkg), alpm_pkg_get_version(pkg)) == 0;
+}
+}  // namespace
+
+void DependencyClosure::revalidate(alpm_handle_t* handle) {
+    const auto generation = db_generation();
+    if (generation == m_generation) {
+        return;
+    }
+    m_generation = generation;
+    m_closures.clear();
+    m_refcount.clear();
+    m_totals = {};
+    for (const auto& [app, names] : m_selected) {
+        add_ref(closure_of(handle, app, names));
+    }
+}
+
+auto DependencyClosure::closure_of(alpm_handle_t* handle, const std::string& app, const std::vector<std::string>& names) -> const closure_t& {
+    if (auto it = m_closures.find(app); it != m_closures.end()) {
+        return it->second;
+    }
+
+    const auto& index = PackageIndex::get(handle);
+    closure_t closure{};
+    std::unordered_set<alpm_pkg_t*> visited{};
+    auto* localdb = alpm_get_localdb(handle);
+    for (const auto& name : names) {
+        auto* pkg = find_sync_pkg(handle, name);
+        if (pkg != nullptr && !is_up_to_date(localdb, pkg) && visited.insert(pkg).second) {
+            closure.push_back(pkg);
+        }
+    }
+    // breadth first over dependencies which are not installed yet
+    for (std::size_t i = 0; i < closure.size(); ++i) {
+        for (auto* dep : alpm::list_view<alpm_depend_t>{alpm_pkg_get_depends(closure[i])}) {
+            auto* provider = find_missing_dep(index, dep);
+            if (provider != nullptr && visited.insert(provider).second) {
+                closure.push_back(provider);
+            }
+        }
+    }
+    return m_closures.emplace(app, std::move(closure)).first->second;
+}
+
+void DependencyClosure::add_ref(const closure_t& closure) noexcept {
+    for (auto* pkg : closure) {
+        if (m_refcount[pkg]++ == 0) {
+            ++m_totals.packages;
+            m_totals.download_size += alpm_pkg_download_size(pkg);
+            m_totals.installed_size += alpm_pkg_get_isize(pkg);
+        }
+    }
+}
+
+void DependencyClosure::release_ref(const closure_t& closure) noexcept {
+    for (auto* pkg : closure) {
+        auto it = m_refcount.find(pkg);
+        if (it == m_refcount.end() || --it->second != 0) {
+            continue;
+        }
+        m_refcount.erase(it);
+        --m_totals.packages;
+        m_totals.download_size -= alpm_pkg_download_size(pkg);
+        m_totals.installed_size -= alpm_pkg_get_isize(pkg);
+    }
+}
+
+void DependencyClosure::select(alpm_handle_t* handle, const std::string& app, const std::vector<std::string>& names) {
+    revalidate(handle);
+    if (!m_selected.emplace(app, names).second) {
+        return;
+    }
+    add_ref(closure_of(handle, app, names));
+}
+
+void DependencyClosure::deselect(alpm_handle_t* handle, const std::string& app) {
+    auto it = m_selected.find(app);
+    if (it == m_selected.end()) {
+        return;
+    }
+    m_selected.erase(it);
+    // after a database change the remaining selection is counted from scratch
+    if (m_generation != db_generation()) {
+        revalidate(handle);
+        return;
+    }
+    release_ref(m_closures.at(app));
+}
+
+void DependencyClosure::clear() noexcept {
+    m_selected.clear();
+    m_closures.clear();
+    m_refcount.clear();
+    m_totals = {};
+}
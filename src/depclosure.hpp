@@ -0,0 +1,64 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef DEPCLOSURE_HPP
+#define DEPCLOSURE_HPP
+
+#include <alpm.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SelectionTotals {
+    std::size_t packages{};  // packages pulled from the sync databases
+    off_t download_size{};
+    off_t installed_size{};
+};
+
+// Packages a selection of apps would pull from the sync databases, kept up
+// to date per toggle. Every selected app holds a reference on each package
+// of its dependency closure, so (de)selecting an app only walks that app's
+// closure instead of resolving the whole selection again.
+class DependencyClosure final {
+ public:
+    void select(alpm_handle_t* handle, const std::string& app, const std::vector<std::string>& names);
+    void deselect(alpm_handle_t* handle, const std::string& app);
+    // drop the selection, e.g. once the app list is rebuilt
+    void clear() noexcept;
+
+    auto totals() const noexcept -> const SelectionTotals& { return m_totals; }
+
+ private:
+    using closure_t = std::vector<alpm_pkg_t*>;
+
+    // closures are memoized per app for the current database generation
+    auto closure_of(alpm_handle_t* handle, const std::string& app, const std::vector<std::string>& names) -> const closure_t&;
+    // recomputes everything if the databases changed since the last toggle
+    void revalidate(alpm_handle_t* handle);
+    void add_ref(const closure_t& closure) noexcept;
+    void release_ref(const closure_t& closure) noexcept;
+
+    std::uint64_t m_generation{};
+    std::unordered_map<std::string, std::vector<std::string>> m_selected{};
+    std::unordered_map<std::string, closure_t> m_closures{};
+    std::unordered_map<alpm_pkg_t*, std::uint32_t> m_refcount{};
+    SelectionTotals m_totals{};
+};
+
+#endif  // DEPCLOSURE_HPP
@@ -32,10 +32,12 @@
 //  API and a minimal footprint. It conforms to the (somewhat) standard INI
 //  format - sections and keys are case insensitive and all leading and
 //  trailing whitespace is ignored. Comments are lines that begin with a
-//  semicolon. Trailing comments are allowed on section lines.
+//  semicolon or a hash. Trailing comments are allowed on section lines.
 //
 //  Files are read on demand, upon which data is kept in memory and the file
-//  is closed. This utility supports lazy writing, which only writes changes
+//  is closed. INIView maps a file read-only and walks its sections and
+//  key/value pairs as string_views, without copying lines; INIReader builds
+//  the INIStructure on top of it. This utility supports lazy writing, which only writes changes
 //  and updates to a file and preserves custom formatting and comments. A lazy
 //  write invoked by a write() call will read the output file, find what
 //  changes have been made and update the file accordingly. If you only need to
@@ -53,15 +55,21 @@
 
 #include <algorithm>
 #include <cctype>
-#include <fstream>
+#include <concepts>
+#include <functional>
+#include <iterator>
 #include <memory>
-#include <sstream>
 #include <string>
-#include <sys/stat.h>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace mINI {
 namespace INIStringUtil {
     static constexpr auto whitespaceDelimiters = " \t\n\r\f\v";
@@ -69,6 +77,14 @@ namespace INIStringUtil {
         str.erase(str.find_last_not_of(whitespaceDelimiters) + 1);
         str.erase(0, str.find_first_not_of(whitespaceDelimiters));
     }
+    constexpr std::string_view trimView(std::string_view str) noexcept {
+        const auto first = str.find_first_not_of(whitespaceDelimiters);
+        if (first == std::string_view::npos) {
+            return {};
+        }
+        const auto last = str.find_last_not_of(whitespaceDelimiters);
+        return str.substr(first, last - first + 1);
+    }
 #ifndef MINI_CASE_SENSITIVE
     inline void toLower(std::string& str) noexcept {
         std::transform(str.begin(), str.end(), str.begin(), [](const char c) {
@@ -87,116 +103,212 @@ namespace INIStringUtil {
     }
 }  // namespace INIStringUtil
 
+namespace INIKeyUtil {
+#ifndef MINI_CASE_SENSITIVE
+    constexpr char normalizeChar(char c) noexcept {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+#else
+    constexpr char normalizeChar(char c) noexcept {
+        return c;
+    }
+#endif
+
+    // hash and compare keys as if they were trimmed (and lowercased),
+    // so lookups by string_view never build a std::string
+    struct Hash {
+        using is_transparent = void;
+        constexpr std::size_t operator()(std::string_view key) const noexcept {
+            std::size_t hash = 14695981039346656037ULL;
+            for (const char c : INIStringUtil::trimView(key)) {
+                hash ^= static_cast<unsigned char>(normalizeChar(c));
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+    };
+    struct Equal {
+        using is_transparent = void;
+        constexpr bool operator()(std::string_view lhs, std::string_view rhs) const noexcept {
+            lhs = INIStringUtil::trimView(lhs);
+            rhs = INIStringUtil::trimView(rhs);
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+                return normalizeChar(a) == normalizeChar(b);
+            });
+        }
+    };
+
+    inline std::string normalize(std::string_view key) {
+        std::string res{INIStringUtil::trimView(key)};
+        std::transform(res.begin(), res.end(), res.begin(), normalizeChar);
+        return res;
+    }
+}  // namespace INIKeyUtil
+
+// Insertion ordered map, a key may hold several values (e.g. repeated
+// "Server =" lines). Erased entries are tombstoned and compacted lazily.
 template <typename T>
 class INIMap {
  private:
-    using T_DataIndexMap  = std::unordered_map<std::string, std::size_t>;
     using T_DataItem      = std::pair<std::string, T>;
     using T_DataContainer = std::vector<T_DataItem>;
+    using T_DataIndexMap  = std::unordered_map<std::string, std::vector<std::size_t>, INIKeyUtil::Hash, INIKeyUtil::Equal>;
     using T_MultiArgs     = typename std::vector<std::pair<std::string, T>>;
 
     T_DataIndexMap dataIndexMap{};
     T_DataContainer data{};
+    std::vector<bool> erased{};
+    std::size_t erasedCount{};
 
-    constexpr std::size_t setEmpty(std::string& key) noexcept {
+    std::size_t append(std::string_view key, T obj) {
         const auto& index = data.size();
-        dataIndexMap[key] = index;
-        data.emplace_back(key, T());
+        auto it           = dataIndexMap.find(key);
+        if (it == dataIndexMap.end()) {
+            it = dataIndexMap.emplace(INIKeyUtil::normalize(key), std::vector<std::size_t>{}).first;
+        }
+        it->second.push_back(index);
+        data.emplace_back(it->first, std::move(obj));
+        erased.push_back(false);
         return index;
     }
 
+    void compact() {
+        T_DataContainer liveData{};
+        liveData.reserve(data.size() - erasedCount);
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            if (!erased[i]) {
+                liveData.emplace_back(std::move(data[i]));
+            }
+        }
+        clear();
+        for (auto& item : liveData) {
+            append(item.first, std::move(item.second));
+        }
+    }
+
  public:
-    using const_iterator = typename T_DataContainer::const_iterator;
+    class const_iterator {
+     private:
+        const INIMap* map{};
+        std::size_t index{};
 
-    INIMap() = default;
+        constexpr void skipErased() noexcept {
+            while (index < map->data.size() && map->erased[index]) {
+                ++index;
+            }
+        }
 
-    INIMap(const INIMap& other) noexcept {
-        const auto& data_size = other.data.size();
-        for (std::size_t i = 0; i < data_size; ++i) {
-            const auto& key = other.data[i].first;
-            const auto& obj = other.data[i].second;
-            data.emplace_back(key, obj);
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T_DataItem;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const T_DataItem*;
+        using reference         = const T_DataItem&;
+
+        constexpr const_iterator() noexcept = default;
+        constexpr const_iterator(const INIMap* parent, std::size_t start) noexcept : map(parent), index(start) { skipErased(); }
+
+        constexpr reference operator*() const noexcept { return map->data[index]; }
+        constexpr pointer operator->() const noexcept { return &map->data[index]; }
+        constexpr const_iterator& operator++() noexcept {
+            ++index;
+            skipErased();
+            return *this;
         }
-        dataIndexMap = T_DataIndexMap(other.dataIndexMap);
-    }
+        constexpr const_iterator operator++(int) noexcept {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        constexpr bool operator==(const const_iterator& other) const noexcept { return index == other.index; }
+    };
 
-    inline T& operator[](std::string key) noexcept {
-        INIStringUtil::trim(key);
-#ifndef MINI_CASE_SENSITIVE
-        INIStringUtil::toLower(key);
-#endif
+    INIMap() = default;
+
+    // first value of the key, inserted if missing
+    inline T& operator[](std::string_view key) {
         const auto& it    = dataIndexMap.find(key);
-        const auto& hasIt = (it != dataIndexMap.end());
-        const auto& index = (hasIt) ? it->second : setEmpty(key);
+        const auto& index = (it != dataIndexMap.end() && !it->second.empty()) ? it->second.front() : append(key, T());
         return data[index].second;
     }
-    constexpr T get(std::string& key) noexcept {
-        INIStringUtil::trim(key);
-#ifndef MINI_CASE_SENSITIVE
-        INIStringUtil::toLower(key);
-#endif
+    inline T get(std::string_view key) const {
         const auto& it = dataIndexMap.find(key);
-        if (it == dataIndexMap.end()) {
+        if (it == dataIndexMap.end() || it->second.empty()) {
             return T();
         }
-        return T(data[it->second].second);
+        return data[it->second.front()].second;
     }
-    constexpr bool has(std::string& key) const noexcept {
-        INIStringUtil::trim(key);
-#ifndef MINI_CASE_SENSITIVE
-        INIStringUtil::toLower(key);
-#endif
-        return (dataIndexMap.count(key) == 1);
+    // every value of the key, in insertion order
+    inline std::vector<std::reference_wrapper<const T>> getAll(std::string_view key) const {
+        std::vector<std::reference_wrapper<const T>> values{};
+        if (const auto& it = dataIndexMap.find(key); it != dataIndexMap.end()) {
+            values.reserve(it->second.size());
+            for (const auto& index : it->second) {
+                values.emplace_back(data[index].second);
+            }
+        }
+        return values;
     }
-    constexpr void set(std::string& key, T obj) {
-        INIStringUtil::trim(key);
-#ifndef MINI_CASE_SENSITIVE
-        INIStringUtil::toLower(key);
-#endif
+    inline bool has(std::string_view key) const noexcept {
+        const auto& it = dataIndexMap.find(key);
+        return it != dataIndexMap.end() && !it->second.empty();
+    }
+    inline std::size_t count(std::string_view key) const noexcept {
+        const auto& it = dataIndexMap.find(key);
+        return (it != dataIndexMap.end()) ? it->second.size() : 0;
+    }
+    // replaces every value of the key with obj
+    inline void set(std::string_view key, T obj) {
         const auto& it = dataIndexMap.find(key);
-        if (it != dataIndexMap.end()) {
-            data[it->second].second = obj;
+        if (it == dataIndexMap.end() || it->second.empty()) {
+            append(key, std::move(obj));
             return;
         }
-        dataIndexMap[key] = data.size();
-        data.emplace_back(key, obj);
+        auto& indices               = it->second;
+        data[indices.front()].second = std::move(obj);
+        for (std::size_t i = 1; i < indices.size(); ++i) {
+            erased[indices[i]] = true;
+            ++erasedCount;
+        }
+        indices.resize(1);
     }
-    constexpr void set(const T_MultiArgs& multiArgs) noexcept {
+    inline void set(const T_MultiArgs& multiArgs) {
         for (const auto& it : multiArgs) {
             const auto& key = it.first;
             const auto& obj = it.second;
             set(key, obj);
         }
     }
-    inline bool remove(std::string& key) noexcept {
-        INIStringUtil::trim(key);
-#ifndef MINI_CASE_SENSITIVE
-        INIStringUtil::toLower(key);
-#endif
+    // adds another value for the key, keeping the existing ones
+    inline void add(std::string_view key, T obj) {
+        append(key, std::move(obj));
+    }
+    inline bool remove(std::string_view key) {
         const auto& it = dataIndexMap.find(key);
-        if (it != dataIndexMap.end()) {
-            const auto& index = it->second;
-            data.erase(data.begin() + index);
-            dataIndexMap.erase(it);
-            for (auto& it2 : dataIndexMap) {
-                auto& vi = it2.second;
-                if (vi > index) {
-                    vi--;
-                }
-            }
-            return true;
+        if (it == dataIndexMap.end()) {
+            return false;
+        }
+        for (const auto& index : it->second) {
+            erased[index] = true;
         }
-        return false;
+        erasedCount += it->second.size();
+        dataIndexMap.erase(it);
+        if (erasedCount > data.size() / 2) {
+            compact();
+        }
+        return true;
     }
-    constexpr void clear() noexcept {
+    inline void clear() noexcept {
         data.clear();
         dataIndexMap.clear();
+        erased.clear();
+        erasedCount = 0;
     }
     constexpr std::size_t size() const noexcept {
-        return data.size();
+        return data.size() - erasedCount;
     }
-    constexpr const_iterator begin() const noexcept { return data.begin(); }
-    constexpr const_iterator end() const noexcept { return data.end(); }
+    constexpr const_iterator begin() const noexcept { return const_iterator{this, 0}; }
+    constexpr const_iterator end() const noexcept { return const_iterator{this, data.size()}; }
 };
 
 using INIStructure = INIMap<INIMap<std::string>>;
@@ -212,90 +324,145 @@ namespace INIParser {
         PDATA_UNKNOWN
     };
 
-    PDataType parseLine(std::string line, T_ParseValues& parseData) noexcept {
-        parseData.first.clear();
-        parseData.second.clear();
-        INIStringUtil::trim(line);
+    // Lines starting with ';' or '#' are comments, "\=" escapes an equal sign in a key.
+    // The returned views point into line.
+    constexpr PDataType parseLine(std::string_view line, std::string_view& first, std::string_view& second) noexcept {
+        first  = {};
+        second = {};
+        line   = INIStringUtil::trimView(line);
         if (line.empty()) {
             return PDataType::PDATA_NONE;
         }
         const char firstCharacter = line[0];
-        if (firstCharacter == ';') {
+        if (firstCharacter == ';' || firstCharacter == '#') {
             return PDataType::PDATA_COMMENT;
         }
         if (firstCharacter == '[') {
-            const auto& commentAt = line.find_first_of(';');
-            if (commentAt != std::string::npos) {
-                line = line.substr(0, commentAt);
-            }
-            const auto& closingBracketAt = line.find_last_of(']');
-            if (closingBracketAt != std::string::npos) {
-                auto section = line.substr(1, closingBracketAt - 1);
-                INIStringUtil::trim(section);
-                parseData.first = section;
+            const auto& sectionLine      = line.substr(0, line.find_first_of(';'));
+            const auto& closingBracketAt = sectionLine.find_last_of(']');
+            if (closingBracketAt != std::string_view::npos) {
+                first = INIStringUtil::trimView(sectionLine.substr(1, closingBracketAt - 1));
                 return PDataType::PDATA_SECTION;
             }
         }
-        auto lineNorm = line;
-        INIStringUtil::replace(lineNorm, "\\=", "  ");
-        const auto& equalsAt = lineNorm.find_first_of('=');
-        if (equalsAt != std::string::npos) {
-            auto key = line.substr(0, equalsAt);
-            INIStringUtil::trim(key);
-            INIStringUtil::replace(key, "\\=", "=");
-            auto value = line.substr(equalsAt + 1);
-            INIStringUtil::trim(value);
-            parseData.first  = key;
-            parseData.second = value;
+        auto equalsAt = line.find('=');
+        while (equalsAt != std::string_view::npos && equalsAt > 0 && line[equalsAt - 1] == '\\') {
+            equalsAt = line.find('=', equalsAt + 1);
+        }
+        if (equalsAt != std::string_view::npos) {
+            first  = INIStringUtil::trimView(line.substr(0, equalsAt));
+            second = INIStringUtil::trimView(line.substr(equalsAt + 1));
+            return PDataType::PDATA_KEYVALUE;
+        }
+        if (firstCharacter != '[') {
+            // a bare key is a flag with an empty value, e.g. "CheckSpace"
+            first = line;
             return PDataType::PDATA_KEYVALUE;
         }
         return PDataType::PDATA_UNKNOWN;
     }
+
+    inline std::string unescapeKey(std::string_view key) {
+        std::string res{key};
+        INIStringUtil::replace(res, "\\=", "=");
+        return res;
+    }
+
+    inline PDataType parseLine(const std::string& line, T_ParseValues& parseData) noexcept {
+        std::string_view first{};
+        std::string_view second{};
+        const auto& result = parseLine(std::string_view{line}, first, second);
+        parseData.first    = (result == PDataType::PDATA_KEYVALUE) ? unescapeKey(first) : std::string{first};
+        parseData.second   = second;
+        return result;
+    }
 }  // namespace INIParser
 
+class INIView {
+ private:
+    const char* m_data{};
+    std::size_t m_size{};
+    bool m_isOpen{};
+
+ public:
+    explicit INIView(const std::string& filename) noexcept {
+        const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return;
+        }
+        struct stat fileStat {};
+        if (fstat(fd, &fileStat) == 0) {
+            m_isOpen = true;
+            m_size   = static_cast<std::size_t>(fileStat.st_size);
+        }
+        if (m_size > 0) {
+            auto* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                m_isOpen = false;
+                m_size   = 0;
+            } else {
+                m_data = static_cast<const char*>(mapped);
+            }
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+    }
+    ~INIView() {
+        if (m_data != nullptr) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+    INIView(const INIView&)            = delete;
+    INIView& operator=(const INIView&) = delete;
+
+    bool isOpen() const noexcept { return m_isOpen; }
+    std::string_view data() const noexcept { return {m_data, m_size}; }
+
+    // fn(type, first, second, line) for every line of the file
+    template <typename F>
+        requires std::invocable<F, INIParser::PDataType, std::string_view, std::string_view, std::string_view>
+    void forEachLine(F&& fn) const {
+        auto contents = data();
+        while (!contents.empty()) {
+            const auto& newlineAt = contents.find('\n');
+            auto line             = contents.substr(0, newlineAt);
+            contents              = (newlineAt == std::string_view::npos) ? std::string_view{} : contents.substr(newlineAt + 1);
+
+            std::string_view first{};
+            std::string_view second{};
+            const auto& parseResult = INIParser::parseLine(line, first, second);
+            fn(parseResult, first, second, line);
+        }
+    }
+
+    // fn(section, key, value) for every key in file order,
+    // keys before the first section get an empty section
+    template <typename F>
+        requires std::invocable<F, std::string_view, std::string_view, std::string_view>
+    void forEach(F&& fn) const {
+        std::string_view section{};
+        forEachLine([&](INIParser::PDataType type, std::string_view first, std::string_view second, std::string_view) {
+            if (type == INIParser::PDataType::PDATA_SECTION) {
+                section = first;
+            } else if (type == INIParser::PDataType::PDATA_KEYVALUE) {
+                fn(section, first, second);
+            }
+        });
+    }
+};
+
 class INIReader {
  public:
     using T_LineData    = std::vector<std::string>;
     using T_LineDataPtr = std::shared_ptr<T_LineData>;
 
  private:
-    std::ifstream fileReadStream{};
+    INIView fileView;
     T_LineDataPtr lineData{};
 
-    T_LineData readFile() noexcept {
-        std::string fileContents{};
-        fileReadStream.seekg(0, std::ios::end);
-        fileContents.resize(static_cast<std::size_t>(fileReadStream.tellg()));
-        fileReadStream.seekg(0, std::ios::beg);
-        const auto& fileSize = fileContents.size();
-        T_LineData output{};
-        if (fileSize == 0) {
-            return output;
-        }
-
-        fileReadStream.read(&fileContents[0], static_cast<ssize_t>(fileSize));
-        fileReadStream.close();
-
-        std::string buffer{};
-        buffer.reserve(256);
-        for (std::size_t i = 0; i < fileSize; ++i) {
-            const auto& c = fileContents[i];
-            if (c == '\n') {
-                output.emplace_back(buffer);
-                buffer.clear();
-                continue;
-            }
-            if (c != '\0' && c != '\r') {
-                buffer += c;
-            }
-        }
-        output.emplace_back(buffer);
-        return output;
-    }
-
  public:
-    explicit INIReader(const std::string_view& filename, bool keepLineData = false) noexcept {
-        fileReadStream.open(filename.data(), std::ios::in | std::ios::binary);
+    explicit INIReader(const std::string_view& filename, bool keepLineData = false) noexcept
+      : fileView(std::string{filename}) {
         if (keepLineData) {
             lineData = std::make_shared<T_LineData>();
         }
@@ -303,36 +470,29 @@ class INIReader {
     ~INIReader() = default;
 
     bool operator>>(INIStructure& data) noexcept {
-        if (!fileReadStream.is_open()) {
+        if (!fileView.isOpen()) {
             return false;
         }
-        auto fileLines = readFile();
         std::string section{};
         bool inSection = false;
         int repeated{};
-        INIParser::T_ParseValues parseData;
-        for (const auto& line : fileLines) {
-            const auto& parseResult = INIParser::parseLine(line, parseData);
+        fileView.forEachLine([&](INIParser::PDataType parseResult, std::string_view first, std::string_view second, std::string_view line) {
             if (parseResult == INIParser::PDataType::PDATA_SECTION) {
                 inSection = true;
-                data[section = parseData.first];
+                data[section = std::string{first}];
             } else if (inSection && parseResult == INIParser::PDataType::PDATA_KEYVALUE) {
-                const auto& key    = parseData.first;
-                const auto& value  = parseData.second;
-                data[section][key] = value;
+                data[section].add(INIParser::unescapeKey(first), std::string{second});
             } else if (parseResult == INIParser::PDataType::PDATA_KEYVALUE) {
-                const auto& key                     = parseData.first;
-                const auto& value                   = parseData.second;
-                data[std::to_string(repeated)][key] = value;
+                data[std::to_string(repeated)][INIParser::unescapeKey(first)] = second;
                 ++repeated;
             }
             if (lineData && parseResult != INIParser::PDataType::PDATA_UNKNOWN) {
                 if (parseResult == INIParser::PDataType::PDATA_KEYVALUE && !inSection) {
-                    continue;
+                    return;
                 }
                 lineData->emplace_back(line);
             }
-        }
+        });
         return true;
     }
     T_LineDataPtr getLines() const noexcept {
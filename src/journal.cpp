@@ -0,0 +1,336 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "journal.hpp"
+#include "alpm_helper.hpp"
+#include "alpmlist.hpp"
+#include "utils.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <ctime>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+// downloads only matter for reuse, a handful of them may share one fsync
+constexpr std::size_t max_buffered_records = 16;
+
+bool is_process_alive(pid_t pid) noexcept {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// seconds since the epoch the system booted at, 0 if unknown
+std::time_t boot_time() noexcept {
+    std::ifstream file{"/proc/stat"};
+    std::string key{};
+    std::time_t value{};
+    while (file >> key) {
+        if (key == "btime" && file >> value) {
+            return value;
+        }
+    }
+    return 0;
+}
+
+// whether any process holds path open, pacman keeps its lock open until it exits
+bool is_file_open(const fs::path& path) noexcept {
+    std::error_code ec{};
+    const auto& target = fs::canonical(path, ec);
+    if (ec) {
+        return false;
+    }
+    for (const auto& proc : fs::directory_iterator{"/proc", ec}) {
+        const auto& name = proc.path().filename().string();
+        if (name.empty() || !std::all_of(name.begin(), name.end(), [](char ch) { return ch >= '0' && ch <= '9'; })) {
+            continue;
+        }
+        std::error_code fd_ec{};
+        for (const auto& fd : fs::directory_iterator{proc.path() / "fd", fd_ec}) {
+            std::error_code link_ec{};
+            if (fs::read_symlink(fd.path(), link_ec) == target) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// db.lck is left over from the interrupted commit if it is no newer than the
+// commit record or predates the boot, and no process has it open
+bool is_stale_lock(const char* lockfile, std::time_t commit_time) noexcept {
+    struct stat st {};
+    if (stat(lockfile, &st) != 0) {
+        return false;
+    }
+    const bool old_enough = (commit_time != 0 && st.st_mtim.tv_sec <= commit_time) || st.st_mtim.tv_sec < boot_time();
+    return old_enough && !is_file_open(lockfile);
+}
+
+bool is_in_cache(alpm_handle_t* handle, const std::string& filename) noexcept {
+    for (const char* cachedir : alpm::list_view<char>{alpm_option_get_cachedirs(handle)}) {
+        std::error_code ec{};
+        if (fs::exists(fs::path{cachedir} / filename, ec)) {
+            return true;
+        }
+    }
+    return false;
+}
+}  // namespace
+
+TransactionJournal& TransactionJournal::instance() noexcept {
+    static TransactionJournal journal{};
+    return journal;
+}
+
+void TransactionJournal::set_path(std::string path) noexcept {
+    m_path = std::move(path);
+}
+
+auto TransactionJournal::pending() const noexcept -> std::optional<JournalState> {
+    if (m_path.empty()) {
+        return std::nullopt;
+    }
+    std::ifstream file{m_path};
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+    std::string content{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    // a record cut short by a crash never made it, drop it
+    content.erase(content.find_last_of('\n') + 1);
+
+    std::optional<JournalState> state{};
+    for (const auto& line : ::utils::make_multiline(content, false, "\n")) {
+        const auto& fields = ::utils::make_multiline(line, false, "\t");
+        if (fields.empty()) {
+            continue;
+        }
+        const auto& kind = fields[0];
+        if (kind == "begin" && fields.size() >= 2) {
+            state = JournalState{};
+            std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), state->pid);
+        } else if (!state) {
+            continue;
+        } else if (kind == "add" && fields.size() >= 3) {
+            (fields[2] == "upgrade" ? state->upgraded : state->added).emplace_back(fields[1]);
+            if (fields.size() >= 4 && fields[3] == "depend") {
+                state->added_as_deps.emplace_back(fields[1]);
+            }
+        } else if (kind == "remove" && fields.size() >= 2) {
+            state->removed.emplace_back(fields[1]);
+        } else if (kind == "download" && fields.size() >= 2) {
+            state->downloaded.emplace_back(fields[1]);
+        } else if (kind == "commit") {
+            state->committing = true;
+            if (fields.size() >= 2) {
+                std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), state->commit_time);
+            }
+        } else if (kind == "install") {
+            state->installing = true;
+        } else if (kind == "end" && (fields.size() < 2 || fields[1] == "ok" || !state->installing)) {
+            // a commit failing before it touched anything needs no recovery
+            state.reset();
+        }
+    }
+    return state;
+}
+
+void TransactionJournal::clear() noexcept {
+    if (m_fd != -1) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_buffer.clear();
+    m_buffered_records = 0;
+    if (!m_path.empty()) {
+        std::error_code ec{};
+        fs::remove(m_path, ec);
+    }
+}
+
+void TransactionJournal::begin(alpm_handle_t* handle) noexcept {
+    if (m_path.empty()) {
+        return;
+    }
+    if (pending()) {
+        spdlog::warn("discarding the journal of an unfinished transaction");
+    }
+    clear();
+
+    std::error_code ec{};
+    fs::create_directories(fs::path{m_path}.parent_path(), ec);
+    m_fd = open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
+        spdlog::error("failed to open the transaction journal {}: {}", m_path, std::strerror(errno));
+        return;
+    }
+
+    append(fmt::format("begin\t{}", getpid()));
+    auto* localdb = alpm_get_localdb(handle);
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_trans_get_add(handle)}) {
+        const char* name  = alpm_pkg_get_name(pkg);
+        const bool is_new = (alpm_db_get_pkg(localdb, name) == nullptr);
+        const bool is_dep = (alpm_pkg_get_reason(pkg) == ALPM_PKG_REASON_DEPEND);
+        append(fmt::format("add\t{}\t{}\t{}", name, is_new ? "new" : "upgrade", is_dep ? "depend" : "explicit"));
+    }
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_trans_get_remove(handle)}) {
+        append(fmt::format("remove\t{}", alpm_pkg_get_name(pkg)));
+    }
+    // the lock is taken before this, a newer one belongs to somebody else
+    append(fmt::format("commit\t{}", std::time(nullptr)));
+    sync();
+}
+
+void TransactionJournal::downloaded(std::string_view filename) noexcept {
+    append(fmt::format("download\t{}", filename));
+    if (m_buffered_records >= max_buffered_records) {
+        sync();
+    }
+}
+
+void TransactionJournal::installing() noexcept {
+    append("install");
+    sync();
+}
+
+void TransactionJournal::finish(bool ok) noexcept {
+    append(fmt::format("end\t{}", ok ? "ok" : "failed"));
+    sync();
+    if (m_fd != -1) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void TransactionJournal::append(std::string_view record) noexcept {
+    if (m_fd == -1) {
+        return;
+    }
+    m_buffer += record;
+    m_buffer += '\n';
+    ++m_buffered_records;
+}
+
+void TransactionJournal::sync() noexcept {
+    if (m_fd == -1 || m_buffer.empty()) {
+        return;
+    }
+    std::string_view pending_data{m_buffer};
+    while (!pending_data.empty()) {
+        const auto written = write(m_fd, pending_data.data(), pending_data.size());
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("failed to write the transaction journal: {}", std::strerror(errno));
+            break;
+        }
+        pending_data.remove_prefix(static_cast<std::size_t>(written));
+    }
+    fdatasync(m_fd);
+    m_buffer.clear();
+    m_buffered_records = 0;
+}
+
+int recover_transaction(alpm_handle_t* handle, const JournalState& state, RecoveryAction action, std::string& error_msg) {
+    if (is_process_alive(state.pid) && state.pid != getpid()) {
+        error_msg = fmt::format("the transaction is still running (pid {})", state.pid);
+        return 1;
+    }
+    // the lock of the interrupted commit may be left behind, but a package
+    // manager started since then may hold one just as well
+    const char* lockfile = alpm_option_get_lockfile(handle);
+    if (state.committing && access(lockfile, F_OK) == 0) {
+        if (!is_stale_lock(lockfile, state.commit_time)) {
+            error_msg = fmt::format("could not lock database: {} exists\n"
+                                    "  if you're sure a package manager is not already\n"
+                                    "  running, you can remove {}",
+                lockfile, lockfile);
+            return 1;
+        }
+        if (unlink(lockfile) == 0) {
+            spdlog::info("removed the stale lock {}", lockfile);
+        }
+    }
+
+    std::vector<std::string> install{};
+    std::vector<std::string> remove{};
+    if (action == RecoveryAction::resume) {
+        const auto reused = std::count_if(state.downloaded.begin(), state.downloaded.end(),
+            [handle](auto&& filename) { return is_in_cache(handle, filename); });
+        spdlog::info("resuming the interrupted transaction, {} downloaded packages are reused", reused);
+
+        // whatever already made it is skipped, upgrades are left to the version check
+        for (const auto& name : state.added) {
+            if (!is_target_installed(handle, name)) {
+                install.emplace_back(name);
+            }
+        }
+        install.insert(install.end(), state.upgraded.begin(), state.upgraded.end());
+        for (const auto& name : state.removed) {
+            if (is_target_installed(handle, name)) {
+                remove.emplace_back(name);
+            }
+        }
+    } else {
+        spdlog::info("rolling back the interrupted transaction");
+        for (const auto& name : state.added) {
+            if (is_target_installed(handle, name)) {
+                remove.emplace_back(name);
+            }
+        }
+        if (!state.installing) {
+            // nothing was touched, downloading is all that happened
+            remove.clear();
+        }
+        for (const auto& name : state.removed) {
+            if (!is_target_installed(handle, name)) {
+                install.emplace_back(name);
+            }
+        }
+    }
+
+    // the recovery is journaled like any other transaction from here on
+    TransactionJournal::instance().clear();
+    const int ret = commit_trans(handle, install, remove, ALPM_TRANS_FLAG_NEEDED, error_msg);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // resumed packages would otherwise all end up explicitly installed
+    if (action == RecoveryAction::resume) {
+        auto* localdb = alpm_get_localdb(handle);
+        for (const auto& name : state.added_as_deps) {
+            if (auto* pkg = alpm_db_get_pkg(localdb, name.c_str())) {
+                alpm_pkg_set_reason(pkg, ALPM_PKG_REASON_DEPEND);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <alpm.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+inline constexpr auto journal_path = "/var/lib/cachyos-pi/transaction.journal";
+
+// What the journal knows about a transaction which never finished.
+struct JournalState {
+    pid_t pid{};                                 // process which ran it
+    std::vector<std::string> added{};            // not installed before
+    std::vector<std::string> added_as_deps{};    // subset of added
+    std::vector<std::string> upgraded{};
+    std::vector<std::string> removed{};
+    std::vector<std::string> downloaded{};       // package files fetched so far
+    std::time_t commit_time{};  // when the commit record was written, 0 if unknown
+    bool committing{};          // downloads may have started
+    bool installing{};  // the system itself may have changed
+};
+
+// Append-only record of every transaction committed through libalpm in this
+// process: the resolved targets, the files downloaded and how far the commit
+// got. pacman runs started from the GUI keep their own log instead. Records are written in
+// batches, each batch is made durable before the step it describes starts.
+class TransactionJournal final {
+ public:
+    static TransactionJournal& instance() noexcept;
+
+    // an empty path disables the journal
+    void set_path(std::string path) noexcept;
+    auto pending() const noexcept -> std::optional<JournalState>;
+    // forgets a pending transaction once it was resumed or rolled back
+    void clear() noexcept;
+
+    // the transaction of handle is prepared and about to be committed
+    void begin(alpm_handle_t* handle) noexcept;
+    void downloaded(std::string_view filename) noexcept;
+    void installing() noexcept;
+    void finish(bool ok) noexcept;
+
+ private:
+    TransactionJournal() = default;
+
+    void append(std::string_view record) noexcept;
+    // writes the buffered records and waits for them to hit the disk
+    void sync() noexcept;
+
+    std::string m_path{journal_path};
+    std::string m_buffer{};
+    std::size_t m_buffered_records{};
+    int m_fd{-1};
+};
+
+enum class RecoveryAction : std::uint8_t {
+    resume,
+    rollback
+};
+
+// Finishes or undoes a pending transaction. Steps which already completed
+// are skipped, packages downloaded before the interruption are reused from
+// the cache. Upgrades can only be resumed, rolling back keeps them.
+// The lock of the interrupted commit is only removed if it provably is
+// stale, otherwise error_msg tells the user to remove it like pacman does.
+int recover_transaction(alpm_handle_t* handle, const JournalState& state, RecoveryAction action, std::string& error_msg);
+
+#endif  // JOURNAL_HPP
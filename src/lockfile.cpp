@@ -39,32 +39,133 @@
 
 #include "lockfile.hpp"
 
-#include <cstdio>
-#include <sys/file.h>
+#include <fcntl.h>
 #include <unistd.h>
 
-// Checks if file is locked by another process (if locked by the same process returns false)
-bool LockFile::isLocked() noexcept {
-    m_fd = open(m_file_path.data(), O_RDONLY);
-    if (m_fd < -1) {
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <thread>
+
+#include <fmt/core.h>
+
+namespace {
+using namespace std::chrono_literals;
+
+// first retry is quick, a long running pacman is polled once a second
+constexpr auto min_backoff = 50ms;
+constexpr auto max_backoff = 1000ms;
+
+template <typename Pred>
+bool wait_with_backoff(Pred&& is_done, std::chrono::milliseconds timeout, const lock_wait_cb& on_wait) {
+    const auto start   = std::chrono::steady_clock::now();
+    auto backoff       = std::chrono::milliseconds{min_backoff};
+    while (!is_done()) {
+        const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        if (waited >= timeout || (on_wait && !on_wait(waited))) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::min(backoff, timeout - waited));
+        backoff = std::min(backoff * 2, std::chrono::milliseconds{max_backoff});
+    }
+    return true;
+}
+
+struct flock make_flock(short type) noexcept {
+    struct flock fl {};
+    fl.l_type   = type;
+    fl.l_whence = SEEK_SET;
+    return fl;
+}
+}  // namespace
+
+LockFile::~LockFile() noexcept {
+    unlock();
+    if (m_fd != -1) {
+        close(m_fd);
+    }
+}
+
+bool LockFile::openFile() noexcept {
+    if (m_fd != -1) {
+        return true;
+    }
+    m_fd = open(m_file_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
         std::perror("open");
         return false;
     }
-    return (lockf(m_fd, F_TEST, 0) != 0);
+    return true;
+}
+
+// Checks if file is locked by another open file description (if locked by this one returns false)
+bool LockFile::isLocked() noexcept {
+    if (m_locked || !openFile()) {
+        return false;
+    }
+    auto fl = make_flock(F_WRLCK);
+    if (fcntl(m_fd, F_OFD_GETLK, &fl) == -1) {
+        std::perror("fcntl");
+        return false;
+    }
+    return fl.l_type != F_UNLCK;
 }
 
 bool LockFile::lock() noexcept {
-    m_fd = open(m_file_path.data(), O_WRONLY);
-    if (m_fd < -1) {
-        std::perror("open");
+    if (m_locked) {
+        return true;
+    }
+    if (!openFile()) {
         return false;
     }
-    // Create a file lock
-    return (lockf(m_fd, F_LOCK, 0) == 0);
+    auto fl = make_flock(F_WRLCK);
+    if (fcntl(m_fd, F_OFD_SETLK, &fl) == -1) {
+        return false;
+    }
+    m_locked = true;
+
+    // let whoever waits for us know who we are
+    const auto& pid = fmt::format("{}\n", getpid());
+    if (ftruncate(m_fd, 0) == 0) {
+        [[maybe_unused]] const auto written = pwrite(m_fd, pid.data(), pid.size(), 0);
+    }
+    return true;
+}
+
+bool LockFile::lock(std::chrono::milliseconds timeout, const lock_wait_cb& on_wait) noexcept {
+    return wait_with_backoff([this] { return lock(); }, timeout, on_wait);
 }
 
 bool LockFile::unlock() noexcept {
-    m_fd = open(m_file_path.data(), O_WRONLY);
-    close(m_fd);
+    if (!m_locked) {
+        return true;
+    }
+    auto fl = make_flock(F_UNLCK);
+    if (fcntl(m_fd, F_OFD_SETLK, &fl) == -1) {
+        std::perror("fcntl");
+        return false;
+    }
+    m_locked = false;
     return true;
 }
+
+pid_t LockFile::holder() noexcept {
+    if (m_locked) {
+        return getpid();
+    }
+    if (!isLocked()) {
+        return -1;
+    }
+    char buf[32]{};
+    const auto len = pread(m_fd, buf, sizeof(buf) - 1, 0);
+    pid_t pid{-1};
+    if (len > 0) {
+        std::from_chars(buf, buf + len, pid);
+    }
+    return pid;
+}
+
+bool wait_for_unlink(const std::string& path, std::chrono::milliseconds timeout, const lock_wait_cb& on_wait) noexcept {
+    return wait_with_backoff([&path] { return access(path.c_str(), F_OK) != 0 && errno == ENOENT; }, timeout, on_wait);
+}
@@ -17,21 +17,54 @@
 #ifndef LOCKFILE_HPP
 #define LOCKFILE_HPP
 
+#include <sys/types.h>
+
+#include <chrono>
+#include <functional>
 #include <string>
 #include <string_view>
 
+// held by every running instance of the app, GUI or batch
+inline constexpr auto instance_lock_path = "/run/lock/cachyos-pi.lock";
+
+// called while waiting for a lock with the time waited so far, returning false gives up
+using lock_wait_cb = std::function<bool(std::chrono::milliseconds waited)>;
+
+// Exclusive lock on a file, held through a single open file description.
+// The lock belongs to this object rather than to the process, so it is
+// neither shared with other threads nor dropped when some other
+// descriptor of the same file is closed. The holder writes its pid into
+// the file so contention can be reported.
 class LockFile final {
  public:
     explicit LockFile(const std::string_view& file_path)
-      : m_file_path(file_path.data()) { }
+      : m_file_path(file_path) { }
+    ~LockFile() noexcept;
+
+    LockFile(const LockFile&)            = delete;
+    LockFile& operator=(const LockFile&) = delete;
 
+    // locked by someone else
     bool isLocked() noexcept;
+    // tries once
     bool lock() noexcept;
+    // retries with exponential backoff until timeout
+    bool lock(std::chrono::milliseconds timeout, const lock_wait_cb& on_wait = {}) noexcept;
     bool unlock() noexcept;
 
+    // pid written by the process holding the lock, -1 if free or unknown
+    pid_t holder() noexcept;
+
  private:
-    int m_fd{};
+    bool openFile() noexcept;
+
     std::string m_file_path{};
+    int m_fd{-1};
+    bool m_locked{};
 };
 
+// pacman doesn't use fcntl locks, its database is locked for as long as the
+// lock file exists. Waits with backoff until the file is gone.
+bool wait_for_unlink(const std::string& path, std::chrono::milliseconds timeout, const lock_wait_cb& on_wait = {}) noexcept;
+
 #endif  // LOCKFILE_HPP
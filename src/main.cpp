@@ -38,21 +38,31 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include "alpm_helper.hpp"
+#include "batch.hpp"
 #include "config.hpp"
+#include "journal.hpp"
 #include "lockfile.hpp"
 #include "mainwindow.hpp"
+#include "profiler.hpp"
+#include "systeminfo.hpp"
 
 #include <unistd.h>
 
 #include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <optional>
 
 #include <QApplication>
+#include <QCursor>
 #include <QIcon>
 #include <QLibraryInfo>
 #include <QLocale>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QTimer>
 #include <QTranslator>
 
 #include <spdlog/async.h>                  // for create_async
@@ -62,22 +72,92 @@
 
 namespace fs = std::filesystem;
 
+namespace {
+// --profile[=trace.json] or CACHYOS_PI_PROFILE=1|trace.json logs where the startup time goes
+void setup_profiler(int argc, char* argv[]) noexcept {
+    std::optional<std::string> trace_path{};
+    if (const char* env = std::getenv("CACHYOS_PI_PROFILE"); env != nullptr && *env != '\0') {
+        trace_path = (std::string_view{env} == "1") ? std::string{} : std::string{env};
+    }
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg == "--profile") {
+            trace_path = std::string{};
+        } else if (arg.starts_with("--profile=")) {
+            trace_path = std::string{arg.substr(10)};
+        }
+    }
+    if (trace_path) {
+        Profiler::instance().enable(std::move(*trace_path));
+    }
+}
+
+// Resume or roll back an interrupted transaction, false if the app can't continue
+bool recover_interrupted_transaction(const JournalState& state) {
+    QMessageBox msgBox;
+    msgBox.setIcon(QMessageBox::Warning);
+    msgBox.setText("<b>" + QObject::tr("The last installation was interrupted.") + "</b>");
+    msgBox.setInformativeText(QObject::tr("It was installing %1 and removing %2 packages. "
+                                          "Resume it, or undo what it already installed?")
+                                  .arg(state.added.size() + state.upgraded.size())
+                                  .arg(state.removed.size()));
+    auto* resume   = msgBox.addButton(QObject::tr("Resume"), QMessageBox::AcceptRole);
+    auto* rollback = msgBox.addButton(QObject::tr("Roll back"), QMessageBox::DestructiveRole);
+    msgBox.addButton(QMessageBox::Cancel);
+    msgBox.exec();
+    if (msgBox.clickedButton() != resume && msgBox.clickedButton() != rollback) {
+        return false;
+    }
+
+    alpm_errno_t err{};
+    auto* handle = init_alpm(&err);
+    if (handle == nullptr) {
+        QMessageBox::critical(nullptr, QObject::tr("Error"), QString::fromStdString(alpm_strerror(err)));
+        return false;
+    }
+    const auto action = (msgBox.clickedButton() == resume) ? RecoveryAction::resume : RecoveryAction::rollback;
+    std::string error_msg{};
+    QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+    const int ret = recover_transaction(handle, state, action, error_msg);
+    QApplication::restoreOverrideCursor();
+    destroy_alpm(handle);
+
+    if (ret != 0) {
+        QMessageBox::critical(nullptr, QObject::tr("Error"),
+            QObject::tr("Could not recover the interrupted transaction:") + "\n" + QString::fromStdString(error_msg));
+        return false;
+    }
+    return true;
+}
+}  // namespace
+
 int main(int argc, char* argv[]) {
+    // batch mode never shows a window, don't bring up Qt at all
+    if (const auto& batch_options = parse_batch_args(argc, argv)) {
+        spdlog::set_pattern("[%^%l%$] %v");
+        return run_batch(*batch_options);
+    }
+
+    setup_profiler(argc, argv);
+
     QApplication app(argc, argv);
     QApplication::setWindowIcon(QIcon::fromTheme(QApplication::applicationName()));
     QApplication::setOrganizationName("CachyOS");
 
     QTranslator qtTran;
-    if (qtTran.load(QLocale::system(), "qt", "_", QLibraryInfo::location(QLibraryInfo::TranslationsPath)))
-        QApplication::installTranslator(&qtTran);
-
     QTranslator qtBaseTran;
-    if (qtBaseTran.load("qtbase_" + QLocale::system().name(), QLibraryInfo::location(QLibraryInfo::TranslationsPath)))
-        QApplication::installTranslator(&qtBaseTran);
-
     QTranslator appTran;
-    if (appTran.load(QApplication::applicationName() + "_" + QLocale::system().name(), "/usr/share/" + app.applicationName() + "/locale"))
-        QApplication::installTranslator(&appTran);
+    {
+        PROFILE_SCOPE("translations");
+        if (qtTran.load(QLocale::system(), "qt", "_", QLibraryInfo::location(QLibraryInfo::TranslationsPath)))
+            QApplication::installTranslator(&qtTran);
+
+        if (qtBaseTran.load("qtbase_" + QLocale::system().name(), QLibraryInfo::location(QLibraryInfo::TranslationsPath)))
+            QApplication::installTranslator(&qtBaseTran);
+
+        if (appTran.load(QApplication::applicationName() + "_" + QLocale::system().name(), "/usr/share/" + app.applicationName() + "/locale"))
+            QApplication::installTranslator(&appTran);
+    }
 
     // Root guard
     if (system("logname |grep -q ^root$") == 0) {
@@ -100,8 +180,11 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (!Config::initialize()) {
-        return EXIT_FAILURE;
+    {
+        PROFILE_SCOPE("Config::initialize");
+        if (!Config::initialize()) {
+            return EXIT_FAILURE;
+        }
     }
 
     Config::instance()->data()["setupmode"] = setup_mode;
@@ -113,20 +196,19 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    // Don't start app if pacman is running, lock dpkg otherwise while the program runs
-    static constexpr auto lock_path = "/var/lib/pacman/db.lck";
-    LockFile lock_file(lock_path);
-    if (fs::exists(lock_path)) {
+    // one instance at a time, they would share the journal and the selection
+    LockFile instance_lock(instance_lock_path);
+    if (!instance_lock.lock()) {
         QApplication::beep();
         QMessageBox::critical(nullptr, QObject::tr("Unable to get exclusive lock"),
-            QObject::tr("Another package management application (like pamac or pacman), "
-                        "is already running. Please close that application first"));
+            QObject::tr("Another instance of the application is already running (pid %1).").arg(instance_lock.holder()));
         return EXIT_FAILURE;
     }
-    lock_file.lock();
 
+    // set up before recovery, whose errors point the user to this log
     static constexpr auto log_name = "/var/log/cachyospi.log";
     if (fs::exists(log_name)) {
+        PROFILE_SCOPE("log rotation");
         std::ifstream currentfile{log_name};
         std::string file_data{std::istreambuf_iterator<char>(currentfile), std::istreambuf_iterator<char>()};
         std::ofstream oldlogfile{fmt::format("{}.old", log_name)};
@@ -141,8 +223,49 @@ int main(int argc, char* argv[]) {
     spdlog::set_level(spdlog::level::debug);
     spdlog::flush_every(std::chrono::seconds(5));
 
+    // an interrupted install leaves its lock behind, deal with it first
+    if (const auto& pending = TransactionJournal::instance().pending()) {
+        if (!recover_interrupted_transaction(*pending)) {
+            // the logger is asynchronous, flush what recovery logged
+            spdlog::shutdown();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // If pacman is running, wait for it to finish before reading the databases
+    static constexpr auto db_lock_path = "/var/lib/pacman/db.lck";
+    if (fs::exists(db_lock_path)) {
+        QProgressDialog progress(QObject::tr("Another package management application (like pamac or pacman) "
+                                             "is running, waiting for it to finish..."),
+            QObject::tr("Cancel"), 0, 0);
+        progress.setWindowModality(Qt::ApplicationModal);
+        progress.setMinimumDuration(0);
+        progress.show();
+        const bool released = wait_for_unlink(db_lock_path, std::chrono::minutes{10}, [&progress](auto&&) {
+            QApplication::processEvents();
+            return !progress.wasCanceled();
+        });
+        progress.close();
+        if (!released) {
+            QApplication::beep();
+            QMessageBox::critical(nullptr, QObject::tr("Unable to get exclusive lock"),
+                QObject::tr("Another package management application (like pamac or pacman), "
+                            "is already running. Please close that application first"));
+            spdlog::shutdown();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // detect system facts once, they are shared by everything below
+    {
+        PROFILE_SCOPE("SystemInfo");
+        [[maybe_unused]] const auto& sysinfo = SystemInfo::instance();
+    }
+
     MainWindow w;
     w.show();
+    // runs once the event loop has processed the first show/paint events
+    QTimer::singleShot(0, [] { Profiler::instance().report(); });
     const auto& status_code = QApplication::exec();
 
     spdlog::shutdown();
@@ -14,50 +14,38 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
-#if defined(__clang__)
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wold-style-cast"
-#pragma clang diagnostic ignored "-Wshadow"
-#elif defined(__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wold-style-cast"
-#pragma GCC diagnostic ignored "-Wshadow"
-#endif
-
-#include <ryml_std.hpp>
-#include <ryml.hpp>
-#include <cpr/cpr.h>
-
-#if defined(__clang__)
-#pragma clang diagnostic pop
-#elif defined(__GNUC__)
-#pragma GCC diagnostic pop
-#endif
-
 #include "mainwindow.hpp"
 #include "ui_mainwindow.h"
 
 #include "about.hpp"
 #include "alpm_helper.hpp"
+#include "alpmlist.hpp"
+#include "cacheprune.hpp"
 #include "config.hpp"
+#include "orphans.hpp"
 #include "pacmancache.hpp"
+#include "profile.hpp"
+#include "profiler.hpp"
+#include "systeminfo.hpp"
+#include "treefilter.hpp"
+#include "upgrades.hpp"
 #include "utils.hpp"
 #include "version.hpp"
-#include "versionnumber.hpp"
 
 #include <alpm.h>
 #include <alpm_list.h>
 
 #include <algorithm>
+#include <unordered_map>
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QFileDialog>
 #include <QMenu>
 #include <QMessageBox>
 #include <QProgressBar>
 #include <QCheckBox>
 #include <QScreen>
-#include <QScrollBar>
 #include <QShortcut>
 
 #include <fmt/ranges.h>
@@ -68,6 +56,7 @@ namespace fs = std::filesystem;
 MainWindow::MainWindow(QWidget* parent) : QDialog(parent),
                                           m_ui(new Ui::MainWindow) {
     spdlog::debug("{} version:{}", QCoreApplication::applicationName().toStdString(), VERSION);
+    PROFILE_SCOPE("MainWindow");
 
     m_setup_assistant_mode = Config::instance()->data()["setupmode"];
 
@@ -76,14 +65,20 @@ MainWindow::MainWindow(QWidget* parent) : QDialog(parent),
 
     resize(1280, 800);
 
-    setup_alpm(m_handle);
-
     connect(&m_timer, &QTimer::timeout, this, &MainWindow::updateBar);
     connect(&m_cmd, &Cmd::started, this, &MainWindow::cmdStart);
     connect(&m_cmd, &Cmd::finished, this, &MainWindow::cmdDone);
     m_conn = connect(&m_cmd, &Cmd::outputAvailable, [](const QString& out) { spdlog::debug("{}", out.trimmed().toStdString()); });
     connect(&m_cmd, &Cmd::errorAvailable, [](const QString& out) { spdlog::warn("{}", out.trimmed().toStdString()); });
     setWindowFlags(Qt::Window);  // for the close, min and max buttons
+
+    // operations queue behind another package manager instead of failing
+    set_db_lock_wait(std::chrono::minutes{10}, [this](std::chrono::milliseconds waited) {
+        m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput),
+            tr("Waiting for another package manager to finish... %1 s").arg(waited.count() / 1000));
+        qApp->processEvents();
+        return true;
+    });
     setup();
 }
 
@@ -100,10 +95,14 @@ void MainWindow::setup() {
     QFont font("monospace");
     font.setStyleHint(QFont::Monospace);
     m_ui->outputBox->setFont(font);
+    m_output = new OutputBuffer(m_ui->outputBox, 5000, this);
 
     m_user   = "--system ";
 
-    m_arch     = PacmanCache::getArch();
+    {
+        PROFILE_SCOPE("PacmanCache::getArch");
+        m_arch = PacmanCache::getArch();
+    }
     m_ver_name = "nil";
 
     connect(qApp, &QApplication::aboutToQuit, this, &MainWindow::cleanup, Qt::QueuedConnection);
@@ -117,6 +116,10 @@ void MainWindow::setup() {
     column_names << ""
                  << "" << tr("Package") << tr("Info") << tr("Description");
     m_ui->treePopularApps->setHeaderLabels(column_names);
+    m_ui->treeUpdates->setHeaderLabels({"", "", tr("Package"), tr("Version"), tr("Description"), tr("Status"), "", tr("Repository"), tr("Download Size")});
+    m_ui->treeUpdates->hideColumn(TreeCol::Check);
+    m_ui->treeUpdates->hideColumn(TreeCol::Status);
+    m_ui->treeUpdates->hideColumn(TreeCol::Displayed);
     loadTxtFiles();
     refreshPopularApps();
 
@@ -166,7 +169,6 @@ bool MainWindow::uninstall(const QString& names) {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
     m_ui->tabWidget->setCurrentWidget(m_ui->tabOutput);
 
-    m_lockfile.unlock();
     // simulate install of selections and present for confirmation
     // if user selects cancel, break routine but return success to avoid error message
     bool is_ok{};
@@ -177,12 +179,13 @@ bool MainWindow::uninstall(const QString& names) {
     displayOutput();
 
     bool success = false;
+    if (!wait_for_db_lock(m_handle))
+        return false;
     if (is_ok) {
         success = m_cmd.run(fmt::format("pacman -R --noconfirm {}", names.toStdString()).c_str());
     } else {
         success = m_cmd.run(fmt::format("yes | pacman -R {}", names.toStdString()).c_str());
     }
-    m_lockfile.lock();
 
     return success;
 }
@@ -190,19 +193,59 @@ bool MainWindow::uninstall(const QString& names) {
 // Run pacman update
 bool MainWindow::update() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
-    m_lockfile.unlock();
     m_ui->tabOutput->isVisible()  // don't display in output if calling to refresh from tabs
         ? m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput), tr("Refreshing sources..."))
         : m_progress->show();
 
-    displayOutput();
-    if (m_cmd.run("pacman -Sy")) {
-        m_lockfile.lock();
+    std::unordered_map<std::string, int> db_progress{};
+    const auto& on_progress = [this, &db_progress](std::string_view dbname, int percent) {
+        // databases are fetched concurrently, show the overall progress
+        db_progress[std::string{dbname}] = percent;
+        int total{};
+        for (const auto& [db, db_percent] : db_progress) {
+            total += db_percent;
+        }
+        m_bar->setValue(total / static_cast<int>(db_progress.size()));
+        if (percent == 100) {
+            outputAvailable(QString::fromStdString(fmt::format("{} synchronized\n", dbname)));
+        }
+        qApp->processEvents();
+    };
+
+    // the progress callback runs the event loop while libalpm holds the handle, nothing may
+    // start a transaction or switch tabs (which refreshes again) until the update returns
+    const QList<QWidget*> controls({m_ui->tabWidget, m_ui->pushInstall, m_ui->pushUninstall, m_ui->pushCleanup,
+        m_ui->pushExportProfile, m_ui->pushCancel, m_ui->pushAbout, m_ui->pushHelp});
+    QList<QWidget*> disabled;
+    for (auto* control : controls) {
+        if (control->isEnabled()) {
+            control->setEnabled(false);
+            disabled << control;
+        }
+    }
+
+    setCursor(QCursor(Qt::BusyCursor));
+    std::vector<std::string> changed_dbs{};
+    const int ret = update_sync_dbs(m_handle, changed_dbs, on_progress);
+    setCursor(QCursor(Qt::ArrowCursor));
+    for (auto* control : disabled) {
+        control->setEnabled(true);
+    }
+    if (ret == 0) {
         spdlog::info("sources updated OK");
+        // package lists are only stale if some database actually changed
+        if (!changed_dbs.empty()) {
+            spdlog::debug("changed databases: {}", changed_dbs);
+            if (!m_repo_list.empty()) {
+                m_repo_list.set_handle(m_handle);
+                m_repo_list.refresh_dbs(changed_dbs);
+            }
+            // "Required By" spans every sync database, cached details can't be kept per database
+            m_pkginfo.clear();
+        }
         m_updated_once = true;
         return true;
     }
-    m_lockfile.lock();
     spdlog::error("problem updating sources");
     QMessageBox::critical(this, tr("Error"), tr("There was a problem updating sources. Some sources may not have provided updates. For more info check: ") + "<a href=\"/var/log/cachyospi.log\">/var/log/cachyospi.log</a>");
     return false;
@@ -267,6 +310,9 @@ void MainWindow::updateBar() {
 
 void MainWindow::checkUncheckItem() {
     if (auto t_widget = qobject_cast<QTreeWidget*>(focusWidget())) {
+        // updates are only ever applied all together
+        if (t_widget == m_ui->treeUpdates)
+            return;
         if (t_widget->currentItem() == nullptr || t_widget->currentItem()->childCount() > 0)
             return;
         const int col  = (t_widget == m_ui->treePopularApps) ? static_cast<int>(PopCol::Check) : static_cast<int>(TreeCol::Check);
@@ -276,125 +322,37 @@ void MainWindow::checkUncheckItem() {
 }
 
 void MainWindow::outputAvailable(const QString& output) {
-    m_ui->outputBox->moveCursor(QTextCursor::End);
-    if (output.contains("\r")) {
-        m_ui->outputBox->moveCursor(QTextCursor::Up, QTextCursor::KeepAnchor);
-        m_ui->outputBox->moveCursor(QTextCursor::EndOfLine, QTextCursor::KeepAnchor);
-    }
-    m_ui->outputBox->insertPlainText(output);
-    m_ui->outputBox->verticalScrollBar()->setValue(m_ui->outputBox->verticalScrollBar()->maximum());
+    m_output->append(output);
 }
 
 // Load info from the .txt files
 void MainWindow::loadTxtFiles() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
-    cpr::Response r = cpr::Get(cpr::Url{"https://raw.githubusercontent.com/xerolinux/xero-piai/main/pkglist.yaml"},
-        cpr::ProgressCallback([&]([[maybe_unused]] auto&& downloadTotal, [[maybe_unused]] auto&& downloadNow, [[maybe_unused]] auto&& uploadTotal,
-                                  [[maybe_unused]] auto&& uploadNow, [[maybe_unused]] auto&& userdata) -> bool { return true; }));
-
-    if (r.error.code == cpr::ErrorCode::OK) {
-        std::ofstream pkglistyaml{"/usr/lib/xero-piai/pkglist.yaml"};
-        pkglistyaml << r.text;
-    }
-
-    QFile file("/usr/lib/xero-piai/pkglist.yaml");
-    if (!file.open(QFile::ReadOnly | QFile::Text)) {
-        spdlog::error("Could not open: {}", file.fileName().toStdString());
-        return;
-    }
-    const auto& src    = file.readAll().toStdString();
-    ryml::Tree tree    = ryml::parse_in_arena(ryml::to_csubstr(src));
-    ryml::NodeRef root = tree.rootref();  // get a reference to the root
-
-    const auto& get_node_key = [](auto&& node) {
-        std::string key{};
-        if (node.has_key() && !node.has_key_tag()) {
-            key = std::string{node.key().str, node.key().len};
-        }
-        return key;
-    };
+    update_catalog();
+    const auto& catalog = load_catalog();
 
-    const auto& process_map = [this, &get_node_key](auto&& parent_category, auto&& node) {
-        for (const ryml::NodeRef& map : node.children()) {
-            std::string category{};
-            for (const ryml::NodeRef& map_child : map.children()) {
-                if (map_child.has_val() && !map_child.has_val_tag()) {
-                    category = std::string{map_child.val().str, map_child.val().len};
-                }
-
-                const std::string key{get_node_key(map_child)};
-
-                if (map_child.is_container()) {
-                    std::vector<std::string> lines;
-                    lines.reserve(map_child.num_children());
-                    for (const ryml::NodeRef& pkg_list : map_child.children()) {
-                        if (pkg_list.has_val() && !pkg_list.has_val_tag()) {
-                            lines.emplace_back(std::string{pkg_list.val().str, pkg_list.val().len});
-                        }
-                    }
-                    for (const auto& line : lines) {
-                        processFile(parent_category, category, ::utils::make_multiline(line, false, " "));
-                    }
-                }
-            }
-        }
-    };
-    for (const ryml::NodeRef& map : root.children()) {
-        std::string category{};
-        for (const ryml::NodeRef& map_child : map.children()) {
-            if (map_child.has_val() && !map_child.has_val_tag()) {
-                category = std::string{map_child.val().str, map_child.val().len};
-            }
-
-            const std::string key{get_node_key(map_child)};
-
-            if (map_child.is_container()) {
-                if (key == "subgroups") {
-                    process_map(category, map_child);
-                } else {
-                    std::vector<std::string> lines;
-                    lines.reserve(map_child.num_children());
-                    for (const ryml::NodeRef& pkg_list : map_child.children()) {
-                        if (pkg_list.has_val() && !pkg_list.has_val_tag()) {
-                            lines.emplace_back(std::string{pkg_list.val().str, pkg_list.val().len});
-                        }
-                    }
-                    for (const auto& line : lines) {
-                        processFile(category, category, ::utils::make_multiline(line, false, " "));
-                    }
-                }
-            }
-        }
+    PROFILE_SCOPE("processFile");
+    for (const auto& entry : catalog) {
+        processFile(entry);
     }
-
-    file.close();
 }
 
 // Process docs
-void MainWindow::processFile(const std::string& group, const std::string& category, const std::vector<std::string>& names) {
-    if (names.empty())
-        return;
-
+void MainWindow::processFile(const CatalogEntry& entry) {
     QString description;
     QString install_names;
     QString uninstall_names;
     QStringList list;
 
-    auto* dbs = alpm_get_syncdbs(m_handle);
-    for (alpm_list_t* i = dbs; i != nullptr; i = i->next) {
-        auto* db  = reinterpret_cast<alpm_db_t*>(i->data);
-        auto* pkg = alpm_db_get_pkg(db, names[0].c_str());
-        if (pkg) {
-            description = alpm_pkg_get_desc(pkg);
-            break;
-        }
+    if (auto* pkg = find_sync_pkg(m_handle, entry.name)) {
+        description = alpm_pkg_get_desc(pkg);
     }
 
-    install_names   = fmt::format("{} {}", names[0], utils::make_multiline_range(names.begin() + 1, names.end(), false, " ")).c_str();
+    install_names   = fmt::format("{} {}", entry.name, utils::make_multiline_range(entry.packages.begin() + 1, entry.packages.end(), false, " ")).c_str();
     uninstall_names = install_names;
 
-    list << QString::fromStdString(category) << QString::fromStdString(names[0])
-         << description << install_names << uninstall_names << QString::fromStdString(group);
+    list << QString::fromStdString(entry.category) << QString::fromStdString(entry.name)
+         << description << install_names << uninstall_names << QString::fromStdString(entry.group);
 
     m_popular_apps << list;
 }
@@ -407,8 +365,13 @@ void MainWindow::refreshPopularApps() {
     m_ui->searchPopular->clear();
     m_ui->pushInstall->setEnabled(false);
     m_ui->pushUninstall->setEnabled(false);
-    m_installed_packages = listInstalled();
-    displayPopularApps();
+    // local database changed, reload the handle and drop details of installed packages
+    refresh_alpm(&m_handle, &m_alpm_err);
+    m_pkginfo.clear();
+    m_selection.clear();
+    m_ui->labelSelection->clear();
+    // the tree is filled once pacman listed what is installed
+    listInstalled([this] { displayPopularApps(); });
 }
 
 // Setup progress dialog
@@ -434,6 +397,7 @@ void MainWindow::setProgressDialog() {
 // Display Popular Apps in the treePopularApps
 void MainWindow::displayPopularApps() const {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
+    PROFILE_SCOPE("displayPopularApps");
     QTreeWidgetItem* topLevelItem = nullptr;
     QTreeWidgetItem* childItem;
 
@@ -517,6 +481,42 @@ void MainWindow::displayPopularApps() const {
     connect(m_ui->treePopularApps, &QTreeWidget::itemClicked, this, &MainWindow::displayInfo, Qt::UniqueConnection);
 }
 
+// Display installed packages with a newer version in the sync databases
+void MainWindow::displayUpdates() {
+    spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
+    PROFILE_SCOPE("displayUpdates");
+
+    m_ui->treeUpdates->blockSignals(true);
+    m_ui->treeUpdates->clear();
+
+    const auto& report = find_upgrades(m_handle);
+    for (const auto& upgrade : report.upgrades) {
+        auto* item = new QTreeWidgetItem(m_ui->treeUpdates);
+        item->setIcon(TreeCol::UpdateIcon, QIcon::fromTheme("software-update-available"));
+        item->setText(TreeCol::Name, QString::fromUtf8(upgrade.name.data(), static_cast<int>(upgrade.name.size())));
+        item->setText(TreeCol::Version, QString::fromStdString(fmt::format("{} \u2192 {}", upgrade.old_version, upgrade.new_version)));
+        item->setText(TreeCol::Description, QString::fromUtf8(alpm_pkg_get_desc(upgrade.sync)));
+        item->setText(TreeCol::Status, QStringLiteral("upgradable"));
+        item->setText(TreeCol::Displayed, QStringLiteral("true"));
+        item->setText(TreeCol::Repository, QString::fromUtf8(upgrade.repo.data(), static_cast<int>(upgrade.repo.size())));
+        item->setText(TreeCol::DownloadSize, QString::fromStdString(format_size(upgrade.download_size)));
+    }
+    for (int i = 0; i < m_ui->treeUpdates->columnCount(); ++i)
+        m_ui->treeUpdates->resizeColumnToContents(i);
+    m_ui->treeUpdates->blockSignals(false);
+
+    m_ui->pushInstall->setText(tr("Upgrade all"));
+    m_ui->pushInstall->setEnabled(!report.upgrades.empty());
+    if (report.upgrades.empty()) {
+        m_ui->labelUpdates->setText(tr("Your system is up to date."));
+        return;
+    }
+    m_ui->labelUpdates->setText(tr("%1 packages can be upgraded, %2 to download, %3 installed size change")
+                                    .arg(report.upgrades.size())
+                                    .arg(QString::fromStdString(format_size(report.download_size)))
+                                    .arg(QString::fromStdString(format_size(report.installed_size_change))));
+}
+
 // Display available packages
 void MainWindow::displayPackages() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
@@ -555,73 +555,64 @@ void MainWindow::ifDownloadFailed() {
 bool MainWindow::confirmActions(const QString& names, const QString& action, bool& is_ok) {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
 
-    std::vector<std::string> change_list(size_t(m_change_list.size()));
-    for (size_t i = 0; i < change_list.size(); ++i) {
-        change_list[i] = m_change_list[int(i)].toStdString();
+    const char* delim     = (names.contains("\n")) ? "\n" : " ";
+    const auto& name_list = ::utils::make_multiline(names.toStdString(), false, delim);
+    // resolved once per target set and database state
+    const auto& preview = m_trans_previews.get(m_handle, name_list, action == "install");
+    is_ok               = (action != "install") || preview.ok;
+
+    if (!is_ok && !confirmConflicts(names, preview.conflict_msg)) {
+        return false;
     }
-    QString msg;
 
-    QString detailed_names;
-    QStringList detailed_installed_names;
-    QString detailed_to_install;
-    QString detailed_removed_names;
-    std::string summary;
-    std::string msg_ok_status;
-
-        m_lockfile.unlock();
-        const char* delim     = (names.contains("\n")) ? "\n" : " ";
-        const auto& name_list = ::utils::make_multiline(names.toStdString(), false, delim);
-        if (action == "install") {
-            add_targets_to_install(m_handle, name_list);
-        } else {
-            is_ok = true;
-            add_targets_to_remove(m_handle, name_list);
-        }
-        detailed_names = display_targets(m_handle, true, summary).c_str();
-        alpm_trans_release(m_handle);
+    return confirmChanges(names, action, preview);
+}
 
-        if (action == "install") {
-            m_lockfile.unlock();
-            refresh_alpm(&m_handle, &m_alpm_err);
-            is_ok = (sync_trans(m_handle, name_list, 0, msg_ok_status) == 0);
-        }
+// Ask whether conflicting packages should be replaced
+bool MainWindow::confirmConflicts(const QString& names, const std::string& conflict_msg) {
+    QMessageBox msgBox;
+    msgBox.setText("<b>The following packages have conflicts.</b>");
+    msgBox.setInformativeText("\n" + names + "\n\n" + conflict_msg.c_str());
 
-    if (!is_ok) {
-        QMessageBox msgBox;
-        msg = "<b>The following packages have conflicts.</b>";
-        msgBox.setText(msg);
-        msgBox.setInformativeText("\n" + names + "\n\n" + msg_ok_status.c_str());
+    msgBox.addButton("Resolve/Install", QMessageBox::ButtonRole::AcceptRole);
+    msgBox.addButton("Cancel/Reject", QMessageBox::ButtonRole::RejectRole);
 
-        msgBox.addButton("Resolve/Install", QMessageBox::ButtonRole::AcceptRole);
-        msgBox.addButton("Cancel/Reject", QMessageBox::ButtonRole::RejectRole);
+    // make it wider
+    auto horizontalSpacer = new QSpacerItem(600, 0, QSizePolicy::Minimum, QSizePolicy::Expanding);
+    auto layout           = qobject_cast<QGridLayout*>(msgBox.layout());
+    layout->addItem(horizontalSpacer, 0, 1);
 
-        // make it wider
-        auto horizontalSpacer = new QSpacerItem(600, 0, QSizePolicy::Minimum, QSizePolicy::Expanding);
-        auto layout           = qobject_cast<QGridLayout*>(msgBox.layout());
-        layout->addItem(horizontalSpacer, 0, 1);
+    return msgBox.exec() == QMessageBox::AcceptRole;
+}
 
-        if (msgBox.exec() != QMessageBox::AcceptRole) {
-            return false;
-        }
+// Present the resolved transaction for confirmation
+bool MainWindow::confirmChanges(const QString& names, const QString& action, const trans_preview_t& preview) {
+    QString detailed_to_install;
+    QString detailed_removed_names;
+    if (action == "install") {
+        detailed_to_install = preview.details.c_str();
+    } else {
+        detailed_removed_names = preview.details.c_str();
     }
-
-        m_lockfile.lock();
-
-        if (action == "install") {
-            detailed_to_install = detailed_names;
-        } else {
-            detailed_removed_names = detailed_names;
+    if (!detailed_removed_names.isEmpty())
+        detailed_removed_names.prepend(tr("Remove") + "\n");
+    if (!detailed_to_install.isEmpty())
+        detailed_to_install.prepend(tr("Install") + "\n");
+
+    // libalpm downloads into the first cache directory
+    QString summary = QString::fromStdString(preview.summary);
+    if (const auto* cachedirs = alpm_option_get_cachedirs(m_handle); cachedirs != nullptr && preview.download_size > 0) {
+        const auto* cachedir  = static_cast<const char*>(cachedirs->data);
+        const auto free_space = SystemInfo::free_space(cachedir);
+        if (free_space && *free_space < static_cast<std::uint64_t>(preview.download_size)) {
+            summary += "\n" + tr("Only %1 are free in %2, which is not enough for the download.")
+                                  .arg(QString::fromStdString(format_size(static_cast<off_t>(*free_space))), cachedir);
         }
-        if (!detailed_removed_names.isEmpty())
-            detailed_removed_names.prepend(tr("Remove") + "\n");
-        if (!detailed_to_install.isEmpty())
-            detailed_to_install.prepend(tr("Install") + "\n");
-
-    msg = "<b>" + tr("The following packages were selected. Click Show Details for list of changes.") + "</b>";
+    }
 
     QMessageBox msgBox;
-    msgBox.setText(msg);
-    msgBox.setInformativeText("\n" + names + "\n\n" + summary.c_str());
+    msgBox.setText("<b>" + tr("The following packages were selected. Click Show Details for list of changes.") + "</b>");
+    msgBox.setInformativeText("\n" + names + "\n\n" + summary);
 
     if (action == "install")
         msgBox.setDetailedText(detailed_to_install + "\n" + detailed_removed_names);
@@ -642,7 +633,6 @@ bool MainWindow::confirmActions(const QString& names, const QString& action, boo
 bool MainWindow::install(const QString& names) {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
 
-    m_lockfile.unlock();
     m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput), tr("Installing packages..."));
 
     // simulate install of selections and present for confirmation
@@ -653,98 +643,135 @@ bool MainWindow::install(const QString& names) {
 
     displayOutput();
     bool success = false;
+    if (!wait_for_db_lock(m_handle))
+        return false;
     if (is_ok) {
         success = m_cmd.run(fmt::format("pacman -S --noconfirm {}", names.toStdString()).c_str());
     } else {
         success = m_cmd.run(fmt::format("yes | pacman -S {}", names.toStdString()).c_str());
     }
-    m_lockfile.lock();
 
     return success;
 }
 
-// install a list of application and run postprocess for each of them.
-bool MainWindow::installBatch(const QStringList& name_list) {
+// Process checked items to install, every checked app goes
+// through a single resolve and commit
+bool MainWindow::installPopularApps() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
-    QString install_names;
-    bool result = true;
 
-    // load all the
-    for (const QString& name : name_list) {
+    if (!m_updated_once)
+        update();
+
+    InstallPlan plan{};
+    QStringList app_names;
+    for (QTreeWidgetItemIterator it(m_ui->treePopularApps); *it; ++it) {
+        if ((*it)->childCount() > 0 || (*it)->checkState(PopCol::Check) != Qt::Checked) {
+            continue;
+        }
+        const QString name = (*it)->text(PopCol::Name);
         for (const QStringList& list : m_popular_apps) {
             if (list.at(Popular::Name) == name) {
-                install_names += list.at(Popular::InstallNames) + QStringLiteral(" ");
+                plan.add_app(name.toStdString(), ::utils::make_multiline(list.at(Popular::InstallNames).toStdString(), false, " "));
+                app_names << name;
+                break;
             }
         }
     }
+    if (plan.empty())
+        return true;
 
-    if (!install_names.isEmpty())
-        if (!install(install_names))
-            result = false;
+    const QString names = app_names.join(" ");
+    m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput), tr("Installing packages..."));
+    setCursor(QCursor(Qt::BusyCursor));
 
-    displayOutput();
-    m_lockfile.lock();
-    return result;
-}
+    // the transaction stays open while the user confirms it
+    auto preview = plan.prepare(m_handle, ALPM_TRANS_FLAG_NEEDED);
+    if (!preview.ok) {
+        setCursor(QCursor(Qt::ArrowCursor));
+        if (!confirmConflicts(names, preview.conflict_msg)) {
+            return true;
+        }
+        setCursor(QCursor(Qt::BusyCursor));
+        preview = plan.prepare(m_handle, ALPM_TRANS_FLAG_NEEDED, true);
+    }
+    setCursor(QCursor(Qt::ArrowCursor));
+    if (!preview.ok) {
+        m_output->append(QString::fromStdString(preview.conflict_msg));
+        return false;
+    }
+    // if user selects cancel, break routine but return success to avoid error message
+    if (!confirmChanges(names, "install", preview)) {
+        plan.release();
+        return true;
+    }
 
-// install named app
-bool MainWindow::installPopularApp(const QString& name) {
-    spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
-    bool result = true;
-    QString install_names;
+    setCursor(QCursor(Qt::BusyCursor));
+    m_output->append(QString::fromStdString(fmt::format("installing {}\n", fmt::join(plan.targets(), " "))));
+    std::string error_msg{};
+    bool result = (plan.commit(error_msg) == 0);
+    setCursor(QCursor(Qt::ArrowCursor));
+    if (!result) {
+        m_output->append(QString::fromStdString(error_msg));
+    }
 
-    // get all the app info
-    for (const QStringList& list : m_popular_apps) {
-        if (list.at(Popular::Name) == name) {
-            install_names = list.at(Popular::InstallNames);
+    for (const auto& [app, outcome] : plan.outcomes()) {
+        switch (outcome) {
+        case AppOutcome::installed:
+            m_output->append(QString::fromStdString(fmt::format("{}: installed\n", app)));
+            break;
+        case AppOutcome::already_installed:
+            m_output->append(QString::fromStdString(fmt::format("{}: already installed\n", app)));
+            break;
+        case AppOutcome::failed:
+            m_output->append(QString::fromStdString(fmt::format("{}: failed\n", app)));
+            result = false;
+            break;
         }
     }
-    displayOutput();
-    // install
-    if (!install_names.isEmpty()) {
-        m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput), tr("Installing ") + name);
-        result = install(install_names);
+
+    // apps which made it are done, failed ones stay checked to retry
+    for (QTreeWidgetItemIterator it(m_ui->treePopularApps); *it; ++it) {
+        const auto& name     = (*it)->text(PopCol::Name).toStdString();
+        const auto& outcomes = plan.outcomes();
+        const auto& found    = std::find_if(outcomes.begin(), outcomes.end(), [&name](auto&& entry) { return entry.first == name; });
+        if (found != outcomes.end() && found->second != AppOutcome::failed) {
+            (*it)->setCheckState(PopCol::Check, Qt::Unchecked);
+        }
     }
-    displayOutput();
-    m_lockfile.lock();
     return result;
 }
 
-// Process checked items to install
-bool MainWindow::installPopularApps() {
+// Upgrade the whole system, partial upgrades of a few packages aren't supported
+// on Arch: a soname bump of one package breaks everything linked against it
+bool MainWindow::upgradeAll() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
+    m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput), tr("Upgrading packages..."));
 
-    QStringList batch_names;
-    bool result = true;
-
-    if (!m_updated_once)
-        update();
+    const auto& report = find_upgrades(m_handle);
+    if (report.upgrades.empty())
+        return true;
 
-    // make a list of apps to be installed together
-    for (QTreeWidgetItemIterator it(m_ui->treePopularApps); *it; ++it) {
-        if ((*it)->checkState(PopCol::Check) == Qt::Checked) {
-            QString name = (*it)->text(2);
-            for (const QStringList& list : m_popular_apps) {
-                if (list.at(Popular::Name) == name) {
-                    batch_names << name;
-                    (*it)->setCheckState(PopCol::Check, Qt::Unchecked);
-                }
-            }
-        }
-    }
+    QString details;
+    for (const auto& upgrade : report.upgrades)
+        details += QString::fromStdString(fmt::format("{} {} -> {}\n", upgrade.name, upgrade.old_version, upgrade.new_version));
 
-    if (!installBatch(batch_names))
-        result = false;
+    // if user selects cancel, break routine but return success to avoid error message
+    QMessageBox msgBox;
+    msgBox.setText("<b>" + tr("%1 packages will be upgraded. Click Show Details for list of changes.").arg(report.upgrades.size()) + "</b>");
+    msgBox.setInformativeText(tr("%1 to download, %2 installed size change")
+                                  .arg(QString::fromStdString(format_size(report.download_size)))
+                                  .arg(QString::fromStdString(format_size(report.installed_size_change))));
+    msgBox.setDetailedText(details);
+    msgBox.addButton(QMessageBox::Ok);
+    msgBox.addButton(QMessageBox::Cancel);
+    if (msgBox.exec() != QMessageBox::Ok)
+        return true;
 
-    // install the rest of the apps
-    for (QTreeWidgetItemIterator it(m_ui->treePopularApps); *it; ++it) {
-        if ((*it)->checkState(PopCol::Check) == Qt::Checked) {
-            if (!installPopularApp((*it)->text(PopCol::Name)))
-                result = false;
-        }
-    }
-    setCursor(QCursor(Qt::ArrowCursor));
-    return result;
+    displayOutput();
+    if (!wait_for_db_lock(m_handle))
+        return false;
+    // against the databases update() synchronized, the ones the list was computed from
+    return m_cmd.run("pacman -Su --noconfirm");
 }
 
 // Install selected items
@@ -755,7 +782,6 @@ bool MainWindow::installSelected() {
 
     bool result = install(names);
     m_change_list.clear();
-    m_installed_packages = listInstalled();
     return result;
 }
 
@@ -796,12 +822,14 @@ bool MainWindow::downloadPackageList(bool force_download) {
                 return false;
         }
         m_progress->show();
-        PacmanCache cache(m_handle);
-        m_repo_list = cache.get_candidates();
+        // a forced update() already re-read the databases that changed
+        if (m_repo_list.empty()) {
+            m_repo_list.set_handle(m_handle);
+            m_repo_list.refresh_list();
+        }
         if (m_repo_list.empty()) {
             update();
-            cache.refresh_list();
-            m_repo_list = cache.get_candidates();
+            m_repo_list.refresh_list();
         }
     }
 
@@ -890,15 +918,13 @@ void MainWindow::copyTree(QTreeWidget* from, QTreeWidget* to) const {
 void MainWindow::cleanup() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
 
-    m_lockfile.unlock();
-
     m_cmd.halt();
     m_settings.setValue("geometry", saveGeometry());
 }
 
 // Get version of the program
 QString MainWindow::getVersion(const std::string_view& name) {
-    return m_cmd.getCmdOut(fmt::format("pacman -Si {} | grep 'Version' | {} | head -1", name, "awk '{print $3}'").c_str());
+    return QString::fromStdString(get_sync_version(m_handle, name));
 }
 
 // Return true if all the packages listed are installed
@@ -930,19 +956,27 @@ bool MainWindow::checkUpgradable(const QStringList& name_list) const {
     });
 }
 
-// Returns list of all installed packages
-QStringList MainWindow::listInstalled() {
+// Reloads the list of installed packages without blocking, then calls on_done;
+// results of a query overtaken by a newer one are dropped
+void MainWindow::listInstalled(std::function<void()> on_done) {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
-    disconnect(m_conn);
-    QString str = m_cmd.getCmdOut("pacman -Qq");
-    m_conn      = connect(&m_cmd, &Cmd::outputAvailable, [](const QString& out) { spdlog::debug("{}", out.trimmed().toStdString()); });
-    return str.split("\n");
+    const auto query = ++m_installed_query;
+    CmdTask::start("pacman -Qq", this)->then([this, query, on_done = std::move(on_done)](const CmdResult& result) {
+        if (query != m_installed_query) {
+            return;
+        }
+        if (!result.ok()) {
+            spdlog::error("failed to list installed packages (exit code {})", result.exit_code);
+        }
+        m_installed_packages = result.ok() ? result.output.split("\n") : QStringList{};
+        on_done();
+    });
 }
 
 // return the visible tree
 void MainWindow::setCurrentTree() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
-    const QList<QTreeWidget*> list({m_ui->treePopularApps});
+    const QList<QTreeWidget*> list({m_ui->treePopularApps, m_ui->treeUpdates});
 
     for (auto item : list) {
         if (item->isVisible()) {
@@ -952,27 +986,6 @@ void MainWindow::setCurrentTree() {
     }
 }
 
-std::unordered_map<QString, VersionNumber> MainWindow::listInstalledVersions() {
-    spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
-    disconnect(m_conn);
-    QString out = m_cmd.getCmdOut("pacman -Q", true);
-    m_conn      = connect(&m_cmd, &Cmd::outputAvailable, [](const QString& cmd_out) { spdlog::debug("{}", cmd_out.trimmed().toStdString()); });
-
-    QString name;
-    std::string ver_str;
-    QStringList item;
-    std::unordered_map<QString, VersionNumber> result;
-
-    const QStringList list = out.split("\n");
-    for (const QString& line : list) {
-        item         = line.simplified().split(" ");
-        name         = item.at(0);
-        ver_str      = item.at(1).toStdString();
-        result[name] = VersionNumber(ver_str);
-    }
-    return result;
-}
-
 // Things to do when the command starts
 void MainWindow::cmdStart() {
     m_timer.start(100);
@@ -1020,22 +1033,14 @@ void MainWindow::displayInfo(const QTreeWidgetItem* item, int column) {
 }
 
 void MainWindow::displayPackageInfo(const QTreeWidgetItem* item) {
-    QString msg     = m_cmd.getCmdOut("pacman -Si " + item->text(2));
-    QString details = m_cmd.getCmdOut("pacman -Siv " + item->text(2));
-
-    auto detail_list  = details.split("\n");
-    auto msg_list     = msg.split("\n");
-    auto max_no_chars = 2000;         // around 15-17 lines
-    auto max_no_lines = 17;           // cut message after these many lines
-    if (msg.size() > max_no_chars) {  // split msg into details if too large
-        msg         = msg_list.mid(0, max_no_lines).join("\n");
-        detail_list = msg_list.mid(max_no_lines, msg_list.length()) + QStringList{""} + detail_list;
-        details     = detail_list.join("\n");
+    const auto* pkg_details = m_pkginfo.get(m_handle, item->text(2).toStdString());
+    if (pkg_details == nullptr) {
+        spdlog::error("package not found: {}", item->text(2).toStdString());
+        return;
     }
-    msg += "\n\n" + detail_list.at(detail_list.size() - 2);  // add info about space needed/freed
 
-    QMessageBox info(QMessageBox::NoIcon, tr("Package info"), msg.trimmed(), QMessageBox::Close);
-    info.setDetailedText(details.trimmed());
+    QMessageBox info(QMessageBox::NoIcon, tr("Package info"), QString::fromStdString(pkg_details->summary).trimmed(), QMessageBox::Close);
+    info.setDetailedText(QString::fromStdString(pkg_details->details).trimmed());
 
     // make it wider
     auto horizontalSpacer = new QSpacerItem(this->width(), 0, QSizePolicy::Minimum, QSizePolicy::Expanding);
@@ -1046,48 +1051,11 @@ void MainWindow::displayPackageInfo(const QTreeWidgetItem* item) {
 
 // Find package in view
 void MainWindow::findPopular() const {
-    QString word = m_ui->searchPopular->text();
+    const QString word = m_ui->searchPopular->text();
     if (word.length() == 1)
         return;
 
-    if (word.isEmpty()) {
-        for (QTreeWidgetItemIterator it(m_ui->treePopularApps); *it; ++it)
-            (*it)->setExpanded(false);
-        m_ui->treePopularApps->reset();
-        for (int i = 0; i < m_ui->treePopularApps->columnCount(); ++i)
-            m_ui->treePopularApps->resizeColumnToContents(i);
-        return;
-    }
-    auto found_items = m_ui->treePopularApps->findItems(word, Qt::MatchContains | Qt::MatchRecursive, 2);
-    found_items << m_ui->treePopularApps->findItems(word, Qt::MatchContains | Qt::MatchRecursive, 4);
-
-    // hide/show items
-    for (QTreeWidgetItemIterator it(m_ui->treePopularApps); *it; ++it) {
-        if ((*it)->childCount() == 0) {  // if child
-            if (found_items.contains(*it)) {
-                (*it)->setHidden(false);
-            } else {
-                (*it)->parent()->setHidden(true);
-                (*it)->setHidden(true);
-            }
-        }
-    }
-
-    // process found items
-    for (auto item : found_items) {
-        if (item->childCount() == 0) {  // if child, expand parent
-            item->parent()->setExpanded(true);
-            item->parent()->setHidden(false);
-        } else {  // if parent, expand children
-            item->setExpanded(true);
-            item->setHidden(false);
-            int count = item->childCount();
-            for (int i = 0; i < count; ++i)
-                item->child(i)->setHidden(false);
-        }
-    }
-    for (int i = 0; i < m_ui->treePopularApps->columnCount(); ++i)
-        m_ui->treePopularApps->resizeColumnToContents(i);
+    filter_tree(m_ui->treePopularApps, word, PopCol::Name, PopCol::Description);
 }
 
 // Find packages in other sources
@@ -1105,7 +1073,7 @@ void MainWindow::findPackageOther() {
 }
 
 void MainWindow::showOutput() {
-    m_ui->outputBox->clear();
+    m_output->clear();
     m_ui->tabWidget->setTabEnabled(m_ui->tabWidget->indexOf(m_ui->tabOutput), true);
     m_ui->tabWidget->setCurrentWidget(m_ui->tabOutput);
     enableTabs(false);
@@ -1129,6 +1097,16 @@ void MainWindow::on_pushInstall_clicked() {
             refreshPopularApps();
             QMessageBox::critical(this, tr("Error"), tr("Problem detected while installing, please inspect the console output."));
         }
+    } else if (m_tree == m_ui->treeUpdates) {
+        bool success = upgradeAll();
+        buildPackageLists();
+        refreshPopularApps();
+        if (success) {
+            QMessageBox::information(this, tr("Done"), tr("Processing finished successfully."));
+            m_ui->tabWidget->setCurrentWidget(m_tree->parentWidget());
+        } else {
+            QMessageBox::critical(this, tr("Error"), tr("Problem detected while installing, please inspect the console output."));
+        }
     } else {
         bool success = installSelected();
         buildPackageLists();
@@ -1148,6 +1126,85 @@ void MainWindow::on_pushAbout_clicked() {
     displayAboutMsgBox(tr("About %1").arg(this->windowTitle()), "<p align=\"center\"><b><h2>" + this->windowTitle() + "</h2></b></p><p align=\"center\">" + tr("Version: ") + VERSION + "</p><p align=\"center\"><h3>" + tr("Package Installer for CachyOS") + R"(</h3></p><p align="center"><a href="http://cachyos.org">http://cachyos.org</a><br /></p><p align="center">)" + tr("Copyright (c) CachyOS") + "<br /><br /></p>",
         "/usr/share/doc/cachyos-packageinstaller/license.html", true);
 }
+// Clean up button clicked, removes orphaned dependencies in one transaction
+// and old package versions from the cache
+void MainWindow::on_pushCleanup_clicked() {
+    spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
+    const auto& report = find_orphans(m_handle);
+
+    std::vector<std::string> cachedirs{};
+    for (const char* cachedir : alpm::list_view<char>{alpm_option_get_cachedirs(m_handle)}) {
+        cachedirs.emplace_back(cachedir);
+    }
+    PackageCacheIndex cache_index(std::move(cachedirs));
+    cache_index.scan();
+    const auto& cache_report = cache_index.plan(default_keep_versions);
+
+    if (report.names.empty() && cache_report.files.empty()) {
+        QMessageBox::information(this, tr("Clean up"), tr("There are no orphaned packages or old cached packages to remove."));
+        return;
+    }
+
+    QMessageBox msgBox;
+    msgBox.setText("<b>" + tr("%1 packages are no longer needed by any installed package.").arg(report.names.size()) + "</b>");
+    msgBox.setInformativeText(tr("Removing them frees %1.").arg(QString::fromStdString(format_size(report.reclaimable_size))) + "\n"
+        + tr("%1 old versions in the package cache take %2.").arg(cache_report.packages).arg(QString::fromStdString(format_size(cache_report.reclaimable_size))));
+    msgBox.setDetailedText(QString::fromStdString(::utils::make_multiline_range(report.names.begin(), report.names.end(), false, "\n")));
+    msgBox.addButton(QMessageBox::Ok);
+    msgBox.addButton(QMessageBox::Cancel);
+    if (msgBox.exec() != QMessageBox::Ok) {
+        return;
+    }
+
+    showOutput();
+    m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput), tr("Uninstalling packages..."));
+
+    std::string error_msg{};
+    bool success{true};
+    if (!report.names.empty()) {
+        m_output->append(QString::fromStdString(fmt::format("removing {}\n", fmt::join(report.names, " "))));
+        success = (remove_orphans(m_handle, report.names, error_msg) == 0);
+    }
+    if (!cache_report.files.empty()) {
+        const auto removed = PackageCacheIndex::remove(cache_report);
+        m_output->append(QString::fromStdString(fmt::format("removed {} files from the package cache\n", removed)));
+    }
+
+    if (!m_repo_list.empty())  // update list if it already exists
+        buildPackageLists();
+    refreshPopularApps();
+    if (success) {
+        QMessageBox::information(this, tr("Success"), tr("Processing finished successfully."));
+        m_ui->tabWidget->setCurrentWidget(m_tree->parentWidget());
+    } else {
+        QMessageBox::critical(this, tr("Error"), tr("We encountered a problem uninstalling the program") + "\n" + QString::fromStdString(error_msg));
+    }
+    enableTabs(true);
+}
+
+// Export button clicked, saves the checked apps as a profile
+void MainWindow::on_pushExportProfile_clicked() {
+    spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
+    Profile profile{};
+    for (QTreeWidgetItemIterator it(m_ui->treePopularApps); *it; ++it) {
+        if ((*it)->childCount() == 0 && (*it)->checkState(PopCol::Check) == Qt::Checked) {
+            profile.apps.emplace_back((*it)->text(PopCol::Name).toStdString());
+        }
+    }
+    if (profile.apps.empty()) {
+        QMessageBox::information(this, tr("Export"), tr("Check the apps the profile should install first."));
+        return;
+    }
+
+    const auto& path = QFileDialog::getSaveFileName(this, tr("Export profile"), QDir::homePath() + "/profile.yaml", tr("Profiles (*.yaml *.yml)"));
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!profile.save(path.toStdString())) {
+        QMessageBox::critical(this, tr("Error"), tr("Could not write %1").arg(path));
+    }
+}
+
 // Help button clicked
 void MainWindow::on_pushHelp_clicked() {
     QString url = "/usr/share/doc/cachyos-packageinstaller/cachyos-pi.html";
@@ -1212,10 +1269,11 @@ void MainWindow::on_tabWidget_currentChanged(int index) {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
     m_ui->tabWidget->setTabText(m_ui->tabWidget->indexOf(m_ui->tabOutput), tr("Console Output"));
     m_ui->pushInstall->setEnabled(false);
+    m_ui->pushInstall->setText(tr("Install"));
     m_ui->pushUninstall->setEnabled(false);
 
-    // reset checkboxes when tab changes
-    if (m_tree != m_ui->treePopularApps) {
+    // reset checkboxes when tab changes, the updates have none
+    if (m_tree != m_ui->treePopularApps && m_tree != m_ui->treeUpdates) {
         m_tree->blockSignals(true);
         m_tree->clearSelection();
 
@@ -1238,6 +1296,14 @@ void MainWindow::on_tabWidget_currentChanged(int index) {
         findPopular();
         m_ui->searchPopular->setFocus();
         break;
+    case Tab::Updates:
+        m_ui->searchPopular->clear();
+        if (!m_updated_once)
+            update();
+        enableTabs(true);
+        setCurrentTree();
+        displayUpdates();
+        break;
     case Tab::Output:
         m_ui->searchPopular->clear();
         m_ui->pushInstall->setDisabled(true);
@@ -1327,7 +1393,7 @@ void MainWindow::on_pushEnter_clicked() {
 void MainWindow::on_lineEdit_returnPressed() {
     spdlog::debug("+++ {} +++", __PRETTY_FUNCTION__);
     m_cmd.write(m_ui->lineEdit->text().toUtf8() + "\n");
-    m_ui->outputBox->appendPlainText(m_ui->lineEdit->text() + "\n");
+    m_output->append(m_ui->lineEdit->text() + "\n");
     m_ui->lineEdit->clear();
     m_ui->lineEdit->setFocus();
 }
@@ -1367,6 +1433,7 @@ void MainWindow::keyPressEvent(QKeyEvent* event) {
 void MainWindow::on_treePopularApps_itemChanged(QTreeWidgetItem* item) {
     if (item->checkState(1) == Qt::Checked)
         m_ui->treePopularApps->setCurrentItem(item);
+    updateSelectionSize(item);
     bool checked   = false;
     bool installed = true;
 
@@ -1384,3 +1451,28 @@ void MainWindow::on_treePopularApps_itemChanged(QTreeWidgetItem* item) {
     else
         m_ui->pushInstall->setText(tr("Install"));
 }
+
+// Keep the size of the selected apps up to date, only the toggled app is resolved
+void MainWindow::updateSelectionSize(QTreeWidgetItem* item) {
+    const auto& install_names = item->text(PopCol::InstallNames);
+    if (install_names.isEmpty()) {
+        return;
+    }
+
+    const auto& app = item->text(PopCol::Name).toStdString();
+    if (item->checkState(PopCol::Check) == Qt::Checked) {
+        m_selection.select(m_handle, app, ::utils::make_multiline(install_names.toStdString(), false, " "));
+    } else {
+        m_selection.deselect(m_handle, app);
+    }
+
+    const auto& totals = m_selection.totals();
+    if (totals.packages == 0) {
+        m_ui->labelSelection->clear();
+        return;
+    }
+    m_ui->labelSelection->setText(tr("%1 packages, %2 to download, %3 installed")
+                                      .arg(totals.packages)
+                                      .arg(QString::fromStdString(format_size(totals.download_size)))
+                                      .arg(QString::fromStdString(format_size(totals.installed_size))));
+}
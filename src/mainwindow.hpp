@@ -41,11 +41,17 @@
 #ifndef MAINWINDOW_HPP
 #define MAINWINDOW_HPP
 
+#include "alpm_helper.hpp"
+#include "catalog.hpp"
 #include "cmd.hpp"
+#include "depclosure.hpp"
 #include "lockfile.hpp"
-#include "versionnumber.hpp"
+#include "outputbuffer.hpp"
+#include "pacmancache.hpp"
+#include "pkginfo.hpp"
 
-#include <map>
+#include <cstdint>
+#include <functional>
 
 #include <QProgressDialog>
 #include <QSettings>
@@ -57,7 +63,7 @@ class MainWindow;
 }
 
 namespace Tab {
-enum { Popular, Output };
+enum { Popular, Updates, Output };
 }
 namespace PopCol {
 enum { Icon,
@@ -75,7 +81,9 @@ enum { Check,
     Version,
     Description,
     Status,
-    Displayed };
+    Displayed,
+    Repository,
+    DownloadSize };
 }
 namespace Popular {
 enum { Category,
@@ -98,16 +106,17 @@ class MainWindow : public QDialog {
     [[nodiscard]] bool checkInstalled(const QStringList& name_list) const;
     [[nodiscard]] bool checkUpgradable(const QStringList& name_list) const;
     bool confirmActions(const QString& names, const QString& action, bool& is_ok);
+    bool confirmChanges(const QString& names, const QString& action, const trans_preview_t& preview);
+    bool confirmConflicts(const QString& names, const std::string& conflict_msg);
     bool downloadPackageList(bool force_download = false);
     bool install(const QString& names);
-    bool installBatch(const QStringList& name_list);
-    bool installPopularApp(const QString& name);
     bool installPopularApps();
     bool installSelected();
     [[nodiscard]] static bool isFilteredName(const QString& name);
     bool readPackageList(bool force_download = false);
     bool uninstall(const QString& names);
     bool update();
+    bool upgradeAll();
 
     void buildChangeList(QTreeWidgetItem* item);
     void cancelDownload();
@@ -116,20 +125,22 @@ class MainWindow : public QDialog {
     void copyTree(QTreeWidget*, QTreeWidget*) const;
     void displayPackages();
     void displayPopularApps() const;
+    void displayUpdates();
     void displayWarning(const QString& repo);
     void enableTabs(bool enable);
     void ifDownloadFailed();
     void loadTxtFiles();
-    void processFile(const std::string& group, const std::string& category, const std::vector<std::string>& names);
+    void processFile(const CatalogEntry& entry);
     void refreshPopularApps();
     void setCurrentTree();
     void setProgressDialog();
     void setup();
     void updateInterface();
+    void updateSelectionSize(QTreeWidgetItem* item);
 
     static QString addSizes(const QString& arg1, const QString& arg2);
     QString getVersion(const std::string_view& name);
-    QStringList listInstalled();
+    void listInstalled(std::function<void()> on_done);
 
     QString m_version{};
 
@@ -154,6 +165,8 @@ class MainWindow : public QDialog {
     void updateBar();
 
     void on_pushAbout_clicked();
+    void on_pushCleanup_clicked();
+    void on_pushExportProfile_clicked();
     void on_pushHelp_clicked();
     void on_pushInstall_clicked();
     void on_pushUninstall_clicked();
@@ -173,17 +186,20 @@ class MainWindow : public QDialog {
  private:
     Ui::MainWindow* m_ui{};
     alpm_errno_t m_alpm_err{};
-    alpm_handle_t* m_handle = alpm_initialize("/", "/var/lib/pacman/", &m_alpm_err);
+    alpm_handle_t* m_handle = init_alpm(&m_alpm_err);
 
     bool m_updated_once{};
     bool m_setup_assistant_mode{true};
     int m_height_app{};
 
     Cmd m_cmd{};
-    LockFile m_lockfile{"/var/lib/pacman/db.lck"};
+    OutputBuffer* m_output{};
+    PackageInfoProvider m_pkginfo{};
+    TransPreviewCache m_trans_previews{};
+    DependencyClosure m_selection{};
     QList<QStringList> m_popular_apps;
     QLocale m_locale{};
-    std::map<QString, QStringList> m_repo_list{};
+    PacmanCache m_repo_list{};
     QMetaObject::Connection m_conn{};
     QProgressBar* m_bar{};
     QProgressDialog* m_progress{};
@@ -195,10 +211,9 @@ class MainWindow : public QDialog {
     QString m_ver_name{};
     QStringList m_change_list{};
     QStringList m_installed_packages{};
+    std::uint64_t m_installed_query{};
     QTimer m_timer{};
     QTreeWidget* m_tree{};  // current/calling tree
-
-    std::unordered_map<QString, VersionNumber> listInstalledVersions();
 };
 
 #endif  // MAINWINDOW_HPP
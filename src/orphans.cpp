@@ -0,0 +1,75 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "orphans.hpp"
+#include "alpm_helper.hpp"
+#include "alpmlist.hpp"
+#include "pkgindex.hpp"
+
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+
+OrphanReport find_orphans(alpm_handle_t* handle) {
+    const auto& index = PackageIndex::get(handle);
+
+    // number of installed packages still requiring each dependency, optional
+    // dependencies keep a package as well, like pacman -Qdt does
+    std::unordered_map<alpm_pkg_t*, std::size_t> required_count{};
+    std::vector<alpm_pkg_t*> queue{};
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_db_get_pkgcache(alpm_get_localdb(handle))}) {
+        if (alpm_pkg_get_reason(pkg) != ALPM_PKG_REASON_DEPEND) {
+            continue;
+        }
+        const alpm::list<char, free> optional_for{alpm_pkg_compute_optionalfor(pkg)};
+        const auto count = index.required_by(pkg).size() + alpm_list_count(optional_for.get());
+        required_count.emplace(pkg, count);
+        if (count == 0) {
+            queue.push_back(pkg);
+        }
+    }
+
+    // removing an orphan releases its dependencies, which may become orphans too
+    OrphanReport report{};
+    for (std::size_t i = 0; i < queue.size(); ++i) {
+        auto* orphan = queue[i];
+        report.names.emplace_back(alpm_pkg_get_name(orphan));
+        report.reclaimable_size += alpm_pkg_get_isize(orphan);
+
+        // counted once per list, the same way they were counted above
+        const auto& release = [&](alpm_list_t* deps) {
+            std::unordered_set<alpm_pkg_t*> released{};
+            for (const auto* dep : alpm::list_view<alpm_depend_t>{deps}) {
+                auto* provider = index.find_local_satisfier(dep);
+                if (provider == nullptr || !released.insert(provider).second) {
+                    continue;
+                }
+                auto it = required_count.find(provider);
+                if (it != required_count.end() && it->second > 0 && --it->second == 0) {
+                    queue.push_back(provider);
+                }
+            }
+        };
+        release(alpm_pkg_get_depends(orphan));
+        release(alpm_pkg_get_optdepends(orphan));
+    }
+    return report;
+}
+
+int remove_orphans(alpm_handle_t* handle, const std::vector<std::string>& names, std::string& error_msg) {
+    // journaled, locked and cleaned up like any other commit
+    return commit_trans(handle, {}, names, ALPM_TRANS_FLAG_RECURSE | ALPM_TRANS_FLAG_NOSAVE, error_msg);
+}
@@ -0,0 +1,38 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef ORPHANS_HPP
+#define ORPHANS_HPP
+
+#include <alpm.h>
+
+#include <string>
+#include <vector>
+
+struct OrphanReport {
+    std::vector<std::string> names{};  // in removal order
+    off_t reclaimable_size{};          // installed size of all of them
+};
+
+// Packages installed as a dependency which nothing needs anymore, not
+// even optionally, including the ones only needed by other orphans.
+OrphanReport find_orphans(alpm_handle_t* handle);
+
+// Removes the packages in a single transaction, dependencies which
+// become unneeded on the way are removed as well.
+int remove_orphans(alpm_handle_t* handle, const std::vector<std::string>& names, std::string& error_msg);
+
+#endif  // ORPHANS_HPP
@@ -0,0 +1,100 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "outputbuffer.hpp"
+
+#include <QScrollBar>
+#include <QTextCursor>
+
+namespace {
+// roughly one frame at 60Hz
+constexpr int flush_interval_ms = 16;
+}  // namespace
+
+OutputBuffer::OutputBuffer(QPlainTextEdit* view, std::size_t max_lines, QObject* parent)
+  : QObject(parent), m_view(view), m_ring(max_lines) {
+    m_view->setMaximumBlockCount(static_cast<int>(max_lines));
+    m_flush_timer.setSingleShot(true);
+    m_flush_timer.setInterval(flush_interval_ms);
+    connect(&m_flush_timer, &QTimer::timeout, this, &OutputBuffer::flush);
+}
+
+void OutputBuffer::pushLine() {
+    const auto& capacity = m_ring.size();
+    m_ring[(m_head + m_count) % capacity] = std::move(m_partial);
+    m_partial.clear();
+    if (m_count < capacity) {
+        ++m_count;
+        return;
+    }
+    // full: the oldest line would be trimmed from the view anyway
+    m_head = (m_head + 1) % capacity;
+}
+
+void OutputBuffer::append(const QString& chunk) {
+    for (const auto& ch : chunk) {
+        if (m_pending_cr) {
+            m_pending_cr = false;
+            if (ch == QLatin1Char('\n')) {
+                pushLine();
+                continue;
+            }
+            // progress output: the line is redrawn from the start
+            m_partial.clear();
+        }
+
+        if (ch == QLatin1Char('\r')) {
+            m_pending_cr = true;
+        } else if (ch == QLatin1Char('\n')) {
+            pushLine();
+        } else {
+            m_partial += ch;
+        }
+    }
+
+    if (!m_flush_timer.isActive()) {
+        m_flush_timer.start();
+    }
+}
+
+void OutputBuffer::flush() {
+    QString text{};
+    for (std::size_t i = 0; i < m_count; ++i) {
+        text += m_ring[(m_head + i) % m_ring.size()];
+        text += QLatin1Char('\n');
+    }
+    text += m_partial;
+    m_head  = 0;
+    m_count = 0;
+
+    // the last block always holds the unfinished line, replace it in place
+    QTextCursor cursor(m_view->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.movePosition(QTextCursor::StartOfBlock, QTextCursor::KeepAnchor);
+    cursor.insertText(text);
+
+    auto* scroll_bar = m_view->verticalScrollBar();
+    scroll_bar->setValue(scroll_bar->maximum());
+}
+
+void OutputBuffer::clear() {
+    m_flush_timer.stop();
+    m_head  = 0;
+    m_count = 0;
+    m_partial.clear();
+    m_pending_cr = false;
+    m_view->clear();
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef OUTPUTBUFFER_HPP
+#define OUTPUTBUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <QObject>
+#include <QPlainTextEdit>
+#include <QString>
+#include <QTimer>
+
+// Line-oriented console sink for the output box.
+// Incoming chunks are split into lines and queued in a fixed size ring,
+// the view is updated at most once per frame and keeps at most max_lines blocks.
+class OutputBuffer final : public QObject {
+    Q_OBJECT
+ public:
+    explicit OutputBuffer(QPlainTextEdit* view, std::size_t max_lines = 5000, QObject* parent = nullptr);
+
+    void append(const QString& chunk);
+    void clear();
+
+ private:
+    void flush();
+    void pushLine();
+
+    QPlainTextEdit* m_view{};
+    QTimer m_flush_timer{};
+
+    // completed lines not yet shown
+    std::vector<QString> m_ring{};
+    std::size_t m_head{};
+    std::size_t m_count{};
+
+    // line being written, carriage return starts it over
+    QString m_partial{};
+    bool m_pending_cr{};
+};
+
+#endif  // OUTPUTBUFFER_HPP
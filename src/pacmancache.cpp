@@ -15,36 +15,82 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "pacmancache.hpp"
-#include "cmd.hpp"
+#include "systeminfo.hpp"
 
-#include <unordered_map>
+#include <algorithm>
+#include <unordered_set>
+
+// the first repository wins unless a later one has a newer version
+void PacmanCache::offer(alpm_pkg_t* pkg, std::size_t db_order) {
+    const char* pkg_name = alpm_pkg_get_name(pkg);
+    const char* pkg_ver  = alpm_pkg_get_version(pkg);
+
+    VersionNumber version{pkg_ver};
+    auto [it, inserted] = m_sources.try_emplace(pkg_name);
+    if (!inserted) {
+        const auto order = version <=> it->second.version;
+        if (order < 0 || (order == 0 && db_order >= it->second.db_order)) {
+            return;
+        }
+    }
+    it->second             = {std::move(version), db_order};
+    m_candidates[pkg_name] = (QStringList() << pkg_ver << alpm_pkg_get_desc(pkg));
+}
 
 void PacmanCache::refresh_list() {
-    QStringList package_list;
-    QStringList version_list;
-    QStringList description_list;
+    m_candidates.clear();
+    m_sources.clear();
 
-    auto* dbs = alpm_get_syncdbs(m_handle);
-    for (alpm_list_t* i = dbs; i != nullptr; i = i->next) {
+    std::size_t db_order{};
+    for (alpm_list_t* i = alpm_get_syncdbs(m_handle); i != nullptr; i = i->next, ++db_order) {
         auto* db = reinterpret_cast<alpm_db_t*>(i->data);
+        for (alpm_list_t* j = alpm_db_get_pkgcache(db); j != nullptr; j = j->next) {
+            offer(reinterpret_cast<alpm_pkg_t*>(j->data), db_order);
+        }
+    }
+}
 
-        auto* pkgcache = alpm_db_get_pkgcache(db);
-        for (alpm_list_t* j = pkgcache; j != nullptr; j = j->next) {
-            auto* pkg            = reinterpret_cast<alpm_pkg_t*>(j->data);
-            const char* pkg_name = alpm_pkg_get_name(pkg);
-            const char* pkg_desc = alpm_pkg_get_desc(pkg);
-            const char* pkg_ver  = alpm_pkg_get_version(pkg);
-
-            package_list << pkg_name;
-            version_list << pkg_ver;
-            description_list << pkg_desc;
+void PacmanCache::refresh_dbs(const std::vector<std::string>& dbnames) {
+    std::vector<alpm_db_t*> dbs{};
+    std::unordered_set<std::size_t> changed{};
+    for (alpm_list_t* i = alpm_get_syncdbs(m_handle); i != nullptr; i = i->next) {
+        auto* db = reinterpret_cast<alpm_db_t*>(i->data);
+        if (std::ranges::find(dbnames, alpm_db_get_name(db)) != dbnames.end()) {
+            changed.insert(dbs.size());
         }
+        dbs.push_back(db);
+    }
+    if (changed.empty()) {
+        return;
     }
 
-    for (int i = 0; i < package_list.size(); ++i) {
-        if (m_candidates.contains(package_list.at(i)) && (VersionNumber(version_list.at(i).toStdString()) <= VersionNumber(m_candidates.at(package_list.at(i)).at(0).toStdString())))
+    // forget whatever the changed databases provided
+    std::vector<std::string> dropped{};
+    for (auto it = m_sources.begin(); it != m_sources.end();) {
+        if (!changed.contains(it->second.db_order)) {
+            ++it;
             continue;
-        m_candidates[package_list.at(i)] = (QStringList() << version_list.at(i) << description_list.at(i));
+        }
+        m_candidates.erase(QString::fromStdString(it->first));
+        dropped.emplace_back(it->first);
+        it = m_sources.erase(it);
+    }
+
+    for (const auto db_order : changed) {
+        for (alpm_list_t* j = alpm_db_get_pkgcache(dbs[db_order]); j != nullptr; j = j->next) {
+            offer(reinterpret_cast<alpm_pkg_t*>(j->data), db_order);
+        }
+    }
+    // a package dropped from a changed database may still be in an unchanged one
+    for (const auto& name : dropped) {
+        for (std::size_t db_order = 0; db_order < dbs.size(); ++db_order) {
+            if (changed.contains(db_order)) {
+                continue;
+            }
+            if (auto* pkg = alpm_db_get_pkg(dbs[db_order], name.c_str()); pkg != nullptr) {
+                offer(pkg, db_order);
+            }
+        }
     }
 }
 
@@ -55,6 +101,6 @@ QString PacmanCache::getArch() {
         {"i686", "i386"},
         {"armv7l", "armhf"}};
 
-    Cmd cmd;
-    return arch_names.at(cmd.getCmdOut("uname -m", true));
+    const auto& arch = SystemInfo::instance().arch();
+    return arch_names.at(QString::fromUtf8(arch.data(), static_cast<int>(arch.size())));
 }
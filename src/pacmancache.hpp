@@ -22,18 +22,39 @@
 #include <alpm.h>
 
 #include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
 
 class PacmanCache {
  public:
+    PacmanCache() = default;
     explicit PacmanCache(alpm_handle_t* handle) : m_handle(handle) { refresh_list(); }
 
+    // the handle is re-initialized after every transaction
+    void set_handle(alpm_handle_t* handle) noexcept { m_handle = handle; }
     void refresh_list();
+    // re-reads only the given sync databases, candidates of the others are kept
+    void refresh_dbs(const std::vector<std::string>& dbnames);
+
+    [[nodiscard]] bool empty() const noexcept { return m_candidates.empty(); }
     [[nodiscard]] std::map<QString, QStringList> get_candidates() const { return m_candidates; }
 
     static QString getArch();
 
  private:
+    struct source_t {
+        VersionNumber version{};
+        std::size_t db_order{};
+    };
+
+    void offer(alpm_pkg_t* pkg, std::size_t db_order);
+
     std::map<QString, QStringList> m_candidates;
+    std::unordered_map<std::string, source_t> m_sources;
     alpm_handle_t* m_handle{};
 };
 
@@ -0,0 +1,345 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pacmanconf.hpp"
+#include "systeminfo.hpp"
+#include "utils.hpp"
+
+#include <glob.h>
+
+#include <algorithm>
+#include <charconv>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+// list options are separated by spaces and may be repeated
+void append_list(std::vector<std::string>& list, std::string_view value) noexcept {
+    for (auto&& item : utils::make_multiline(value, false, " ")) {
+        list.emplace_back(std::move(item));
+    }
+}
+
+// SigLevel values are applied on top of level, the same way pacman does
+bool apply_siglevel(std::string_view value, int& level) noexcept {
+    for (std::string_view token : utils::make_multiline(value, false, " ")) {
+        bool package{true};
+        bool database{true};
+        if (token.starts_with("Package")) {
+            database = false;
+            token.remove_prefix(7);
+        } else if (token.starts_with("Database")) {
+            package = false;
+            token.remove_prefix(8);
+        }
+
+        if (token == "Never") {
+            if (package) {
+                level &= ~ALPM_SIG_PACKAGE;
+            }
+            if (database) {
+                level &= ~ALPM_SIG_DATABASE;
+            }
+        } else if (token == "Optional") {
+            if (package) {
+                level |= ALPM_SIG_PACKAGE | ALPM_SIG_PACKAGE_OPTIONAL;
+            }
+            if (database) {
+                level |= ALPM_SIG_DATABASE | ALPM_SIG_DATABASE_OPTIONAL;
+            }
+        } else if (token == "Required") {
+            if (package) {
+                level |= ALPM_SIG_PACKAGE;
+                level &= ~ALPM_SIG_PACKAGE_OPTIONAL;
+            }
+            if (database) {
+                level |= ALPM_SIG_DATABASE;
+                level &= ~ALPM_SIG_DATABASE_OPTIONAL;
+            }
+        } else if (token == "TrustedOnly") {
+            if (package) {
+                level &= ~(ALPM_SIG_PACKAGE_MARGINAL_OK | ALPM_SIG_PACKAGE_UNKNOWN_OK);
+            }
+            if (database) {
+                level &= ~(ALPM_SIG_DATABASE_MARGINAL_OK | ALPM_SIG_DATABASE_UNKNOWN_OK);
+            }
+        } else if (token == "TrustAll") {
+            if (package) {
+                level |= ALPM_SIG_PACKAGE_MARGINAL_OK | ALPM_SIG_PACKAGE_UNKNOWN_OK;
+            }
+            if (database) {
+                level |= ALPM_SIG_DATABASE_MARGINAL_OK | ALPM_SIG_DATABASE_UNKNOWN_OK;
+            }
+        } else {
+            spdlog::error("config: invalid value for 'SigLevel' : '{}'", token);
+            return false;
+        }
+    }
+    level &= ~ALPM_SIG_USE_DEFAULT;
+    return true;
+}
+
+int parse_usage(std::string_view value) noexcept {
+    int usage{};
+    for (const auto& token : utils::make_multiline(value, false, " ")) {
+        if (token == "Sync") {
+            usage |= ALPM_DB_USAGE_SYNC;
+        } else if (token == "Search") {
+            usage |= ALPM_DB_USAGE_SEARCH;
+        } else if (token == "Install") {
+            usage |= ALPM_DB_USAGE_INSTALL;
+        } else if (token == "Upgrade") {
+            usage |= ALPM_DB_USAGE_UPGRADE;
+        } else if (token == "All") {
+            usage |= ALPM_DB_USAGE_ALL;
+        } else {
+            spdlog::error("config: usage option '{}' not recognized", token);
+        }
+    }
+    return (usage != 0) ? usage : ALPM_DB_USAGE_ALL;
+}
+
+void add_server(PacmanRepo& repo, std::string server) noexcept {
+    utils::replace_all(server, "$repo", repo.name);
+    repo.servers.emplace_back(std::move(server));
+}
+}  // namespace
+
+PacmanConfigCache& PacmanConfigCache::instance() noexcept {
+    static PacmanConfigCache cache{};
+    return cache;
+}
+
+auto PacmanConfigCache::lookup(const std::string& path) noexcept -> entry_t* {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        m_entries.erase(path);
+        return nullptr;
+    }
+
+    auto& entry = m_entries[path];
+    if (entry.ini && entry.size == st.st_size
+        && entry.mtime.tv_sec == st.st_mtim.tv_sec && entry.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        return &entry;
+    }
+
+    auto ini = std::make_shared<mINI::INIStructure>();
+    mINI::INIFile file(path);
+    if (!file.read(*ini)) {
+        m_entries.erase(path);
+        return nullptr;
+    }
+    entry.mtime = st.st_mtim;
+    entry.size  = st.st_size;
+    entry.ini   = std::move(ini);
+    entry.mirrors.clear();
+    return &entry;
+}
+
+auto PacmanConfigCache::load(const std::string& path) noexcept -> ini_ptr_t {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    auto* entry = lookup(path);
+    return entry != nullptr ? entry->ini : nullptr;
+}
+
+auto PacmanConfigCache::mirrors(const std::string& path, std::string_view arch) noexcept -> mirrors_ptr_t {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    auto* entry = lookup(path);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    auto& mirrors = entry->mirrors[std::string{arch}];
+    if (mirrors) {
+        return mirrors;
+    }
+
+    auto servers = std::make_shared<std::vector<std::string>>();
+    for (const auto& section : *entry->ini) {
+        for (const auto& server : section.second.getAll("server")) {
+            if (server.get().starts_with("/")) {
+                continue;
+            }
+            auto& url = servers->emplace_back(server.get());
+            utils::replace_all(url, "$arch", arch);
+        }
+    }
+    mirrors = std::move(servers);
+    return mirrors;
+}
+
+void PacmanConfigCache::clear() noexcept {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    m_entries.clear();
+}
+
+auto PacmanConfigCache::expand_include(const std::string& pattern) noexcept -> std::vector<std::string> {
+    glob_t globbuf{};
+    const int ret = ::glob(pattern.c_str(), GLOB_NOCHECK, nullptr, &globbuf);
+    if (ret != 0) {
+        spdlog::warn("config: could not expand include '{}'", pattern);
+        globfree(&globbuf);
+        return {};
+    }
+
+    std::vector<std::string> files{};
+    files.reserve(globbuf.gl_pathc);
+    for (std::size_t i = 0; i < globbuf.gl_pathc; ++i) {
+        files.emplace_back(globbuf.gl_pathv[i]);
+    }
+    globfree(&globbuf);
+    return files;
+}
+
+auto PacmanConfig::load(const std::string& path) noexcept -> std::optional<PacmanConfig> {
+    auto& config_cache = PacmanConfigCache::instance();
+    const auto& ini    = config_cache.load(path);
+    if (!ini) {
+        spdlog::error("config: could not read '{}'", path);
+        return std::nullopt;
+    }
+
+    PacmanConfig config{};
+    bool dbpath_set{};
+    bool logfile_set{};
+    std::string local_file_siglevel{};
+    std::string remote_file_siglevel{};
+
+    // [options] always comes first in pacman.conf, repositories need the
+    // final architecture and default signature level
+    if (ini->has("options")) {
+        for (const auto& [key, value] : ini->get("options")) {
+            if (key == "rootdir") {
+                config.rootdir = value;
+            } else if (key == "dbpath") {
+                config.dbpath = value;
+                dbpath_set    = true;
+            } else if (key == "logfile") {
+                config.logfile = value;
+                logfile_set    = true;
+            } else if (key == "gpgdir") {
+                config.gpgdir = value;
+            } else if (key == "cachedir") {
+                append_list(config.cachedirs, value);
+            } else if (key == "hookdir") {
+                append_list(config.hookdirs, value);
+            } else if (key == "architecture") {
+                append_list(config.architectures, value);
+            } else if (key == "ignorepkg") {
+                append_list(config.ignorepkgs, value);
+            } else if (key == "ignoregroup") {
+                append_list(config.ignoregroups, value);
+            } else if (key == "noupgrade") {
+                append_list(config.noupgrade, value);
+            } else if (key == "noextract") {
+                append_list(config.noextract, value);
+            } else if (key == "siglevel") {
+                apply_siglevel(value, config.siglevel);
+            } else if (key == "localfilesiglevel") {
+                local_file_siglevel = value;
+            } else if (key == "remotefilesiglevel") {
+                remote_file_siglevel = value;
+            } else if (key == "paralleldownloads") {
+                unsigned int downloads{};
+                const auto* last = value.data() + value.size();
+                const auto& res  = std::from_chars(value.data(), last, downloads);
+                if (res.ec != std::errc{} || res.ptr != last || downloads == 0) {
+                    spdlog::error("config: invalid value for 'ParallelDownloads' : '{}'", value);
+                    continue;
+                }
+                config.parallel_downloads = downloads;
+            } else if (key == "checkspace") {
+                config.checkspace = true;
+            } else if (key == "usesyslog") {
+                config.usesyslog = true;
+            } else if (key == "disabledownloadtimeout") {
+                config.disable_download_timeout = true;
+            }
+        }
+    }
+
+    // paths follow RootDir unless they were set explicitly
+    if (config.rootdir != "/") {
+        if (!dbpath_set) {
+            config.dbpath = config.rootdir + "/var/lib/pacman/";
+        }
+        if (!logfile_set) {
+            config.logfile = config.rootdir + "/var/log/pacman.log";
+        }
+    }
+    if (config.cachedirs.empty()) {
+        config.cachedirs.emplace_back("/var/cache/pacman/pkg/");
+    }
+    if (config.hookdirs.empty()) {
+        config.hookdirs.emplace_back("/etc/pacman.d/hooks/");
+    }
+    // the system hook directory always comes first
+    config.hookdirs.insert(config.hookdirs.begin(), "/usr/share/libalpm/hooks/");
+
+    // "auto", also the default, is the machine architecture as uname reports it;
+    // levels like x86_64_v3 are only accepted when configured explicitly
+    if (config.architectures.empty()) {
+        config.architectures.emplace_back("auto");
+    }
+    std::vector<std::string> architectures{};
+    for (auto& configured : config.architectures) {
+        auto resolved = (configured == "auto") ? std::string{SystemInfo::instance().arch()} : std::move(configured);
+        if (std::find(architectures.begin(), architectures.end(), resolved) == architectures.end()) {
+            architectures.emplace_back(std::move(resolved));
+        }
+    }
+    config.architectures = std::move(architectures);
+    // $arch of server urls is the primary architecture
+    const std::string arch{config.architectures.front()};
+
+    config.local_file_siglevel  = config.siglevel;
+    config.remote_file_siglevel = config.siglevel;
+    apply_siglevel(local_file_siglevel, config.local_file_siglevel);
+    apply_siglevel(remote_file_siglevel, config.remote_file_siglevel);
+
+    for (const auto& [section, nested] : *ini) {
+        if (section == "options") {
+            continue;
+        }
+
+        auto& repo = config.repos.emplace_back(PacmanRepo{.name = section});
+        for (const auto& [key, value] : nested) {
+            if (key == "include") {
+                for (const auto& file : PacmanConfigCache::expand_include(value)) {
+                    // the mirrorlist is parsed once and shared by every repository including it
+                    const auto& mirrors = config_cache.mirrors(file, arch);
+                    if (!mirrors) {
+                        spdlog::warn("config: could not read included file '{}'", file);
+                        continue;
+                    }
+                    for (const auto& server : *mirrors) {
+                        add_server(repo, server);
+                    }
+                }
+            } else if (key == "server") {
+                auto server = value;
+                utils::replace_all(server, "$arch", arch);
+                add_server(repo, std::move(server));
+            } else if (key == "siglevel") {
+                repo.siglevel = config.siglevel;
+                apply_siglevel(value, repo.siglevel);
+            } else if (key == "usage") {
+                repo.usage = parse_usage(value);
+            }
+        }
+    }
+    return config;
+}
@@ -0,0 +1,105 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PACMANCONF_HPP
+#define PACMANCONF_HPP
+
+#include "ini.hpp"
+
+#include <alpm.h>
+#include <sys/stat.h>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// pacman.conf and the files it includes, each file is parsed once per
+// modification and the result is shared by every section including it.
+class PacmanConfigCache final {
+ public:
+    using ini_ptr_t     = std::shared_ptr<const mINI::INIStructure>;
+    using mirrors_ptr_t = std::shared_ptr<const std::vector<std::string>>;
+
+    static PacmanConfigCache& instance() noexcept;
+
+    // nullptr if the file cannot be read
+    auto load(const std::string& path) noexcept -> ini_ptr_t;
+    // servers of a mirrorlist in file order, "$arch" is already expanded,
+    // "$repo" is left for the caller
+    auto mirrors(const std::string& path, std::string_view arch) noexcept -> mirrors_ptr_t;
+    void clear() noexcept;
+
+    // files matched by an Include value, which may be a glob pattern
+    static auto expand_include(const std::string& pattern) noexcept -> std::vector<std::string>;
+
+ private:
+    PacmanConfigCache() = default;
+
+    struct entry_t {
+        struct timespec mtime {};
+        off_t size{};
+        ini_ptr_t ini{};
+        std::unordered_map<std::string, mirrors_ptr_t> mirrors{};
+    };
+
+    // returns the entry for path, re-parsed if the file changed since the last load
+    auto lookup(const std::string& path) noexcept -> entry_t*;
+
+    std::mutex m_mutex{};
+    std::unordered_map<std::string, entry_t> m_entries{};
+};
+
+struct PacmanRepo {
+    std::string name{};
+    std::vector<std::string> servers{};  // "$repo" and "$arch" expanded
+    int siglevel{ALPM_SIG_USE_DEFAULT};
+    int usage{ALPM_DB_USAGE_ALL};
+};
+
+// Options and repositories of pacman.conf, with the defaults and
+// conventions pacman itself applies to them.
+struct PacmanConfig {
+    std::string rootdir{"/"};
+    std::string dbpath{"/var/lib/pacman/"};
+    std::string logfile{"/var/log/pacman.log"};
+    std::string gpgdir{"/etc/pacman.d/gnupg/"};
+    std::vector<std::string> cachedirs{};
+    std::vector<std::string> hookdirs{};
+    std::vector<std::string> architectures{};
+    std::vector<std::string> ignorepkgs{};
+    std::vector<std::string> ignoregroups{};
+    std::vector<std::string> noupgrade{};
+    std::vector<std::string> noextract{};
+
+    int siglevel{ALPM_SIG_PACKAGE | ALPM_SIG_PACKAGE_OPTIONAL | ALPM_SIG_DATABASE | ALPM_SIG_DATABASE_OPTIONAL};
+    int local_file_siglevel{ALPM_SIG_USE_DEFAULT};
+    int remote_file_siglevel{ALPM_SIG_USE_DEFAULT};
+    unsigned int parallel_downloads{1};
+    bool checkspace{};
+    bool usesyslog{};
+    bool disable_download_timeout{};
+
+    std::vector<PacmanRepo> repos{};
+
+    // std::nullopt if the file cannot be read
+    static auto load(const std::string& path) noexcept -> std::optional<PacmanConfig>;
+};
+
+#endif  // PACMANCONF_HPP
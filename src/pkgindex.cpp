@@ -0,0 +1,166 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pkgindex.hpp"
+#include "alpm_helper.hpp"
+#include "alpmlist.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+struct dep_deleter {
+    void operator()(alpm_depend_t* dep) const noexcept { alpm_dep_free(dep); }
+};
+
+bool version_matches(const char* version, const alpm_depend_t* dep) noexcept {
+    const int cmp = alpm_pkg_vercmp(version, dep->version);
+    switch (dep->mod) {
+    case ALPM_DEP_MOD_EQ:
+        return cmp == 0;
+    case ALPM_DEP_MOD_GE:
+        return cmp >= 0;
+    case ALPM_DEP_MOD_LE:
+        return cmp <= 0;
+    case ALPM_DEP_MOD_GT:
+        return cmp > 0;
+    case ALPM_DEP_MOD_LT:
+        return cmp < 0;
+    default:
+        return true;
+    }
+}
+
+void add_provider(auto& providers, alpm_pkg_t* pkg) {
+    providers[alpm_pkg_get_name(pkg)].push_back(pkg);
+    for (const auto* provide : alpm::list_view<alpm_depend_t>{alpm_pkg_get_provides(pkg)}) {
+        auto& list = providers[provide->name];
+        // a package may list the same name more than once
+        if (list.empty() || list.back() != pkg) {
+            list.push_back(pkg);
+        }
+    }
+}
+}  // namespace
+
+const PackageIndex& PackageIndex::get(alpm_handle_t* handle) {
+    static PackageIndex index{};
+    if (index.m_handle != handle || index.m_generation != db_generation()) {
+        index.build(handle);
+    }
+    return index;
+}
+
+void PackageIndex::build(alpm_handle_t* handle) {
+    m_handle     = handle;
+    m_generation = db_generation();
+    m_sync_providers.clear();
+    m_local_providers.clear();
+    m_local_dependents.clear();
+
+    for (auto* db : alpm::list_view<alpm_db_t>{alpm_get_syncdbs(handle)}) {
+        // libalpm only resolves targets and dependencies from databases with Install usage
+        int usage{};
+        alpm_db_get_usage(db, &usage);
+        if ((usage & ALPM_DB_USAGE_INSTALL) == 0) {
+            continue;
+        }
+        for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_db_get_pkgcache(db)}) {
+            add_provider(m_sync_providers, pkg);
+        }
+    }
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_db_get_pkgcache(alpm_get_localdb(handle))}) {
+        add_provider(m_local_providers, pkg);
+        for (const auto* dep : alpm::list_view<alpm_depend_t>{alpm_pkg_get_depends(pkg)}) {
+            m_local_dependents[dep->name].push_back({pkg, dep});
+        }
+    }
+    spdlog::debug("package index: {} sync names, {} local names", m_sync_providers.size(), m_local_providers.size());
+}
+
+bool PackageIndex::satisfies(alpm_pkg_t* pkg, const alpm_depend_t* dep) noexcept {
+    const std::string_view dep_name{dep->name};
+    if (dep_name == alpm_pkg_get_name(pkg) && (dep->mod == ALPM_DEP_MOD_ANY || version_matches(alpm_pkg_get_version(pkg), dep))) {
+        return true;
+    }
+    for (const auto* provide : alpm::list_view<alpm_depend_t>{alpm_pkg_get_provides(pkg)}) {
+        if (dep_name != provide->name) {
+            continue;
+        }
+        if (dep->mod == ALPM_DEP_MOD_ANY) {
+            return true;
+        }
+        // only a versioned provision can satisfy a versioned dependency
+        if (provide->mod == ALPM_DEP_MOD_EQ && version_matches(provide->version, dep)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+alpm_pkg_t* PackageIndex::find_satisfier(const providers_t& providers, const alpm_depend_t* dep) noexcept {
+    const auto& it = providers.find(dep->name);
+    if (it == providers.end()) {
+        return nullptr;
+    }
+    const auto& candidates = it->second;
+    const std::string_view dep_name{dep->name};
+    const auto& literal = std::find_if(candidates.begin(), candidates.end(), [&](auto* pkg) {
+        return dep_name == alpm_pkg_get_name(pkg) && satisfies(pkg, dep);
+    });
+    if (literal != candidates.end()) {
+        return *literal;
+    }
+    const auto& provider = std::find_if(candidates.begin(), candidates.end(), [&](auto* pkg) { return satisfies(pkg, dep); });
+    return (provider != candidates.end()) ? *provider : nullptr;
+}
+
+alpm_pkg_t* PackageIndex::find_sync_satisfier(const alpm_depend_t* dep) const noexcept {
+    return find_satisfier(m_sync_providers, dep);
+}
+
+alpm_pkg_t* PackageIndex::find_local_satisfier(const alpm_depend_t* dep) const noexcept {
+    return find_satisfier(m_local_providers, dep);
+}
+
+alpm_pkg_t* PackageIndex::find_sync_satisfier(const char* depstring) const noexcept {
+    const std::unique_ptr<alpm_depend_t, dep_deleter> dep{alpm_dep_from_string(depstring)};
+    return (dep != nullptr) ? find_sync_satisfier(dep.get()) : nullptr;
+}
+
+std::vector<alpm_pkg_t*> PackageIndex::required_by(alpm_pkg_t* pkg) const {
+    std::vector<alpm_pkg_t*> res{};
+    const auto& collect = [&](std::string_view name) {
+        const auto& it = m_local_dependents.find(name);
+        if (it == m_local_dependents.end()) {
+            return;
+        }
+        for (const auto& dependent : it->second) {
+            if (dependent.pkg != pkg && satisfies(pkg, dependent.dep)
+                && std::find(res.begin(), res.end(), dependent.pkg) == res.end()) {
+                res.push_back(dependent.pkg);
+            }
+        }
+    };
+
+    collect(alpm_pkg_get_name(pkg));
+    for (const auto* provide : alpm::list_view<alpm_depend_t>{alpm_pkg_get_provides(pkg)}) {
+        collect(provide->name);
+    }
+    return res;
+}
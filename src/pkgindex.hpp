@@ -0,0 +1,66 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PKGINDEX_HPP
+#define PKGINDEX_HPP
+
+#include <alpm.h>
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Provides, depends and required-by relations of the local and sync
+// databases, built once per database generation so satisfier lookups and
+// removal checks are hash lookups instead of walks over every package.
+class PackageIndex final {
+ public:
+    // index of the handle, rebuilt lazily once the databases changed
+    static const PackageIndex& get(alpm_handle_t* handle);
+
+    // first package satisfying dep, in repository order, exact names
+    // are preferred over provides the same way libalpm does, databases
+    // without Install usage are left out
+    alpm_pkg_t* find_sync_satisfier(const alpm_depend_t* dep) const noexcept;
+    alpm_pkg_t* find_local_satisfier(const alpm_depend_t* dep) const noexcept;
+    // dependency string form, e.g. "sh" or "glibc>=2.36"
+    alpm_pkg_t* find_sync_satisfier(const char* depstring) const noexcept;
+
+    // installed packages with a dependency satisfied by pkg
+    std::vector<alpm_pkg_t*> required_by(alpm_pkg_t* pkg) const;
+
+    static bool satisfies(alpm_pkg_t* pkg, const alpm_depend_t* dep) noexcept;
+
+ private:
+    struct dependent_t {
+        alpm_pkg_t* pkg{};
+        const alpm_depend_t* dep{};
+    };
+    using providers_t = std::unordered_map<std::string_view, std::vector<alpm_pkg_t*>>;
+
+    void build(alpm_handle_t* handle);
+    static alpm_pkg_t* find_satisfier(const providers_t& providers, const alpm_depend_t* dep) noexcept;
+
+    alpm_handle_t* m_handle{};
+    std::uint64_t m_generation{};
+    // keys point into the package data owned by libalpm
+    providers_t m_sync_providers{};
+    providers_t m_local_providers{};
+    std::unordered_map<std::string_view, std::vector<dependent_t>> m_local_dependents{};
+};
+
+#endif  // PKGINDEX_HPP
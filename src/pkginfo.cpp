@@ -0,0 +1,177 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pkginfo.hpp"
+#include "alpmlist.hpp"
+
+#include <cstdlib>
+#include <ctime>
+#include <iterator>
+
+#include <fmt/core.h>
+
+namespace {
+std::string format_date(alpm_time_t timestamp) {
+    const auto time = static_cast<std::time_t>(timestamp);
+    std::tm tm{};
+    localtime_r(&time, &tm);
+
+    char buf[64]{};
+    std::strftime(buf, sizeof(buf), "%c", &tm);
+    return buf;
+}
+
+std::string join_strings(alpm_list_t* list) {
+    if (list == nullptr) {
+        return "None";
+    }
+    std::string res{};
+    for (const char* str : alpm::list_view<char>{list}) {
+        if (!res.empty()) {
+            res += "  ";
+        }
+        res += str;
+    }
+    return res;
+}
+
+std::string join_deps(alpm_list_t* list, std::string_view delim = "  ") {
+    if (list == nullptr) {
+        return "None";
+    }
+    std::string res{};
+    for (auto* dep : alpm::list_view<alpm_depend_t>{list}) {
+        if (!res.empty()) {
+            res += delim;
+        }
+        res += alpm::unique_cstr{alpm_dep_compute_string(dep)}.get();
+    }
+    return res;
+}
+
+// computed lists are owned by the caller
+std::string join_owned(alpm_list_t* list) {
+    const alpm::list<char, free> owned{list};
+    return join_strings(owned.get());
+}
+
+void add_field(std::string& out, std::string_view field, std::string_view value) {
+    out += fmt::format("{:<16}: {}\n", field, value);
+}
+
+PackageDetails make_details(alpm_handle_t* handle, alpm_pkg_t* pkg) {
+    PackageDetails res{alpm_pkg_get_name(pkg), alpm_pkg_get_version(pkg), {}, {}};
+    auto& summary = res.summary;
+
+    // optional fields of the desc file come back as nullptr
+    const char* url      = alpm_pkg_get_url(pkg);
+    const char* desc     = alpm_pkg_get_desc(pkg);
+    const char* arch     = alpm_pkg_get_arch(pkg);
+    const char* packager = alpm_pkg_get_packager(pkg);
+    add_field(summary, "Repository", alpm_db_get_name(alpm_pkg_get_db(pkg)));
+    add_field(summary, "Name", res.name);
+    add_field(summary, "Version", res.version);
+    add_field(summary, "Description", desc ? desc : "None");
+    add_field(summary, "Architecture", arch ? arch : "None");
+    add_field(summary, "URL", url ? url : "None");
+    add_field(summary, "Licenses", join_strings(alpm_pkg_get_licenses(pkg)));
+    add_field(summary, "Groups", join_strings(alpm_pkg_get_groups(pkg)));
+    add_field(summary, "Provides", join_deps(alpm_pkg_get_provides(pkg)));
+    add_field(summary, "Depends On", join_deps(alpm_pkg_get_depends(pkg)));
+    add_field(summary, "Optional Deps", join_deps(alpm_pkg_get_optdepends(pkg), "\n                  "));
+    add_field(summary, "Conflicts With", join_deps(alpm_pkg_get_conflicts(pkg)));
+    add_field(summary, "Replaces", join_deps(alpm_pkg_get_replaces(pkg)));
+    add_field(summary, "Download Size", format_size(alpm_pkg_get_size(pkg)));
+    add_field(summary, "Installed Size", format_size(alpm_pkg_get_isize(pkg)));
+    add_field(summary, "Packager", packager ? packager : "Unknown Packager");
+    add_field(summary, "Build Date", format_date(alpm_pkg_get_builddate(pkg)));
+
+    auto& details = res.details;
+    add_field(details, "Required By", join_owned(alpm_pkg_compute_requiredby(pkg)));
+    add_field(details, "Optional For", join_owned(alpm_pkg_compute_optionalfor(pkg)));
+
+    // sync databases carry no file lists, the installed version does
+    auto* local_pkg = alpm_db_get_pkg(alpm_get_localdb(handle), res.name.c_str());
+    if (local_pkg == nullptr) {
+        details += fmt::format("\nTotal Installed Size: {}\n", format_size(alpm_pkg_get_isize(pkg)));
+        return res;
+    }
+
+    add_field(details, "Installed", alpm_pkg_get_version(local_pkg));
+    add_field(details, "Install Date", format_date(alpm_pkg_get_installdate(local_pkg)));
+    details += fmt::format("\nNet Upgrade Size: {}\n", format_size(alpm_pkg_get_isize(pkg) - alpm_pkg_get_isize(local_pkg)));
+
+    const auto* files = alpm_pkg_get_files(local_pkg);
+    details += fmt::format("\nFiles ({}):\n", files->count);
+    for (std::size_t i = 0; i < files->count; ++i) {
+        details += fmt::format("/{}\n", files->files[i].name);
+    }
+    return res;
+}
+}  // namespace
+
+std::string format_size(off_t bytes) {
+    static constexpr const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+
+    auto size = static_cast<double>(bytes);
+    std::size_t unit{};
+    while ((size >= 1024. || size <= -1024.) && unit + 1 < std::size(units)) {
+        size /= 1024.;
+        ++unit;
+    }
+    return fmt::format("{:.2f} {}", size, units[unit]);
+}
+
+alpm_pkg_t* find_sync_pkg(alpm_handle_t* handle, std::string_view name) {
+    const std::string pkgname{name};
+    for (auto* db : alpm::list_view<alpm_db_t>{alpm_get_syncdbs(handle)}) {
+        if (auto* pkg = alpm_db_get_pkg(db, pkgname.c_str())) {
+            return pkg;
+        }
+    }
+    return nullptr;
+}
+
+std::string get_sync_version(alpm_handle_t* handle, std::string_view name) {
+    auto* pkg = find_sync_pkg(handle, name);
+    return (pkg != nullptr) ? alpm_pkg_get_version(pkg) : std::string{};
+}
+
+const PackageDetails* PackageInfoProvider::get(alpm_handle_t* handle, std::string_view name) {
+    if (auto it = m_index.find(name); it != m_index.end()) {
+        // most recently used entries live at the front
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return &*it->second;
+    }
+
+    auto* pkg = find_sync_pkg(handle, name);
+    if (pkg == nullptr) {
+        return nullptr;
+    }
+
+    if (m_lru.size() >= m_capacity && !m_lru.empty()) {
+        m_index.erase(m_lru.back().name);
+        m_lru.pop_back();
+    }
+    m_lru.emplace_front(make_details(handle, pkg));
+    m_index.emplace(m_lru.front().name, m_lru.begin());
+    return &m_lru.front();
+}
+
+void PackageInfoProvider::clear() noexcept {
+    m_index.clear();
+    m_lru.clear();
+}
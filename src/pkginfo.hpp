@@ -0,0 +1,61 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PKGINFO_HPP
+#define PKGINFO_HPP
+
+#include <alpm.h>
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct PackageDetails {
+    std::string name{};
+    std::string version{};
+    std::string summary{};  // pacman -Si alike
+    std::string details{};  // everything else: files, reverse dependencies, sizes
+};
+
+// Formats package details straight from the sync and local databases,
+// recently viewed packages are kept in a small LRU cache.
+class PackageInfoProvider final {
+ public:
+    explicit PackageInfoProvider(std::size_t capacity = 64) : m_capacity(capacity) { }
+
+    // nullptr if no sync database provides the package
+    const PackageDetails* get(alpm_handle_t* handle, std::string_view name);
+    // must be called once the databases change or the handle is re-initialized
+    void clear() noexcept;
+
+ private:
+    using lru_list_t = std::list<PackageDetails>;
+
+    std::size_t m_capacity{};
+    lru_list_t m_lru{};
+    std::unordered_map<std::string_view, lru_list_t::iterator> m_index{};
+};
+
+// first sync package with that name, in repository order
+alpm_pkg_t* find_sync_pkg(alpm_handle_t* handle, std::string_view name);
+std::string get_sync_version(alpm_handle_t* handle, std::string_view name);
+
+// human readable size, e.g. "12.34 MiB"
+std::string format_size(off_t bytes);
+
+#endif  // PKGINFO_HPP
@@ -0,0 +1,134 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#pragma clang diagnostic ignored "-Wshadow"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wshadow"
+#endif
+
+#include <ryml_std.hpp>
+#include <ryml.hpp>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include "profile.hpp"
+#include "alpm_helper.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+std::vector<std::string> read_list(const ryml::NodeRef& root, ryml::csubstr key) {
+    std::vector<std::string> res{};
+    if (!root.has_child(key)) {
+        return res;
+    }
+    for (const ryml::NodeRef& item : root[key].children()) {
+        if (item.has_val() && !item.has_val_tag()) {
+            res.emplace_back(item.val().str, item.val().len);
+        }
+    }
+    return res;
+}
+
+void write_list(std::string& out, std::string_view key, const std::vector<std::string>& list) {
+    if (list.empty()) {
+        return;
+    }
+    out += fmt::format("{}:\n", key);
+    for (const auto& item : list) {
+        out += fmt::format("  - {}\n", item);
+    }
+}
+
+}  // namespace
+
+auto Profile::load(const std::string& path) noexcept -> std::optional<Profile> {
+    std::ifstream file{path};
+    if (!file.is_open()) {
+        spdlog::error("Could not open profile: {}", path);
+        return std::nullopt;
+    }
+    const std::string src{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    ryml::Tree tree    = ryml::parse_in_arena(ryml::to_csubstr(src));
+    ryml::NodeRef root = tree.rootref();
+
+    Profile profile{};
+    if (!root.is_map()) {
+        return profile;
+    }
+    profile.apps     = read_list(root, "apps");
+    profile.packages = read_list(root, "packages");
+    profile.remove   = read_list(root, "remove");
+    return profile;
+}
+
+bool Profile::save(const std::string& path) const noexcept {
+    std::string out{};
+    write_list(out, "apps", apps);
+    write_list(out, "packages", packages);
+    write_list(out, "remove", remove);
+
+    std::ofstream file{path};
+    file << out;
+    return static_cast<bool>(file);
+}
+
+ProfileDiff diff_profile(alpm_handle_t* handle, const Profile& profile, const std::vector<CatalogEntry>& catalog) {
+    std::vector<std::string> wanted{};
+    for (const auto& app : profile.apps) {
+        if (const auto* entry = find_app(catalog, app)) {
+            wanted.insert(wanted.end(), entry->packages.begin(), entry->packages.end());
+        } else {
+            wanted.emplace_back(app);
+        }
+    }
+    wanted.insert(wanted.end(), profile.packages.begin(), profile.packages.end());
+
+    ProfileDiff diff{};
+    std::unordered_set<std::string_view> seen{};
+    for (const auto& target : wanted) {
+        if (seen.insert(target).second && !is_target_installed(handle, target)) {
+            diff.install.emplace_back(target);
+        }
+    }
+
+    auto* localdb = alpm_get_localdb(handle);
+    for (const auto& name : profile.remove) {
+        // asked for and removed at once would never settle, installing wins
+        if (seen.contains(name)) {
+            spdlog::warn("'{}' is both installed and removed by the profile, keeping it", name);
+            continue;
+        }
+        if (seen.insert(name).second && alpm_db_get_pkg(localdb, name.c_str()) != nullptr) {
+            diff.remove.emplace_back(name);
+        }
+    }
+    return diff;
+}
@@ -0,0 +1,58 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include "catalog.hpp"
+
+#include <alpm.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// Apps and packages a machine should have, e.g.
+//   apps:      [firefox, vlc]   # catalog entries
+//   packages:  [htop]           # plain package names or groups
+//   remove:    [nano]           # must not be installed
+struct Profile {
+    std::vector<std::string> apps{};
+    std::vector<std::string> packages{};
+    std::vector<std::string> remove{};
+
+    // std::nullopt if the file can't be read
+    static auto load(const std::string& path) noexcept -> std::optional<Profile>;
+    bool save(const std::string& path) const noexcept;
+};
+
+// What has to change for the local database to match a profile.
+struct ProfileDiff {
+    std::vector<std::string> install{};  // targets which aren't installed yet
+    std::vector<std::string> remove{};   // installed packages the profile removes
+
+    /* clang-format off */
+    bool empty() const noexcept
+    { return install.empty() && remove.empty(); }
+    /* clang-format on */
+};
+
+// Compares the profile with the local database only, nothing is resolved
+// and no lock is taken, so a satisfied profile costs a few lookups.
+// Apps missing from the catalog are taken as package names.
+ProfileDiff diff_profile(alpm_handle_t* handle, const Profile& profile, const std::vector<CatalogEntry>& catalog);
+
+#endif  // PROFILE_HPP
@@ -0,0 +1,128 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "profiler.hpp"
+
+#include <unistd.h>
+
+#include <fstream>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+// nesting of the scopes open on this thread
+thread_local std::uint32_t t_depth{};
+
+std::uint32_t thread_index() noexcept {
+    static std::atomic<std::uint32_t> next{};
+    thread_local const std::uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+double to_ms(Profiler::clock_t::duration duration) noexcept {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+std::int64_t to_us(Profiler::clock_t::duration duration) noexcept {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+std::string escape_json(std::string_view str) {
+    std::string res{};
+    res.reserve(str.size());
+    for (const char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            res += '\\';
+        }
+        res += ch;
+    }
+    return res;
+}
+}  // namespace
+
+Profiler& Profiler::instance() noexcept {
+    static Profiler profiler{};
+    return profiler;
+}
+
+void Profiler::enable(std::string trace_path) noexcept {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_trace_path = std::move(trace_path);
+    m_origin     = clock_t::now();
+    m_events.clear();
+    m_enabled.store(true, std::memory_order_relaxed);
+}
+
+auto Profiler::begin(std::string_view name) noexcept -> std::size_t {
+    const auto depth = t_depth++;
+    const auto tid   = thread_index();
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.push_back({name, clock_t::now(), {}, depth, tid});
+    return m_events.size() - 1;
+}
+
+void Profiler::end(std::size_t index) noexcept {
+    const auto now = clock_t::now();
+    --t_depth;
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    // enable() may have been called again in between
+    if (index < m_events.size()) {
+        m_events[index].duration = now - m_events[index].start;
+    }
+}
+
+void Profiler::report() noexcept {
+    if (!enabled()) {
+        return;
+    }
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    spdlog::info("startup: {:.2f} ms since start", to_ms(clock_t::now() - m_origin));
+    for (const auto& event : m_events) {
+        const auto indent = static_cast<std::size_t>(event.depth) * 2;
+        spdlog::info("  {:>{}}{:<{}} {:>10.2f} ms", "", indent, event.name, 40 - indent, to_ms(event.duration));
+    }
+
+    if (!m_trace_path.empty() && !write_trace()) {
+        spdlog::error("Failed to write profiler trace to '{}'", m_trace_path);
+    }
+
+    // the report covers startup only, later scopes would just grow the buffer
+    m_enabled.store(false, std::memory_order_relaxed);
+    m_events.clear();
+    m_events.shrink_to_fit();
+}
+
+bool Profiler::write_trace() const noexcept {
+    std::ofstream trace{m_trace_path};
+    if (!trace.is_open()) {
+        return false;
+    }
+
+    const auto pid = ::getpid();
+    trace << "{\"traceEvents\":[\n";
+    for (std::size_t i = 0; i < m_events.size(); ++i) {
+        const auto& event = m_events[i];
+        trace << fmt::format(R"({{"name":"{}","cat":"startup","ph":"X","ts":{},"dur":{},"pid":{},"tid":{}}}{})",
+            escape_json(event.name), to_us(event.start - m_origin), to_us(event.duration), pid, event.tid,
+            (i + 1 < m_events.size()) ? ",\n" : "\n");
+    }
+    trace << "],\"displayTimeUnit\":\"ms\"}\n";
+    return trace.good();
+}
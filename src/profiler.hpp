@@ -0,0 +1,97 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Wall-clock breakdown of named phases, used to find out where startup time goes.
+// Recording is off until enable() is called, a disabled scope costs one load.
+// Building with -DNPROFILER removes the scopes entirely.
+class Profiler final {
+ public:
+    using clock_t = std::chrono::steady_clock;
+
+    static Profiler& instance() noexcept;
+
+    // trace_path: where to write a Chrome trace (chrome://tracing, Perfetto), empty for none
+    void enable(std::string trace_path = {}) noexcept;
+    bool enabled() const noexcept { return m_enabled.load(std::memory_order_relaxed); }
+
+    // logs the phases recorded so far, writes the trace, if any, and stops recording
+    void report() noexcept;
+
+ private:
+    friend class ScopedTimer;
+
+    struct event_t {
+        std::string_view name{};
+        clock_t::time_point start{};
+        clock_t::duration duration{};
+        std::uint32_t depth{};
+        std::uint32_t tid{};
+    };
+
+    Profiler() = default;
+
+    auto begin(std::string_view name) noexcept -> std::size_t;
+    void end(std::size_t index) noexcept;
+    bool write_trace() const noexcept;
+
+    std::atomic<bool> m_enabled{};
+    std::string m_trace_path{};
+    clock_t::time_point m_origin{};
+
+    std::mutex m_mutex{};
+    std::vector<event_t> m_events{};
+};
+
+// Times the enclosing scope, name must outlive the profiler (use a literal).
+class ScopedTimer final {
+ public:
+    explicit ScopedTimer(std::string_view name) noexcept
+      : m_index(Profiler::instance().enabled() ? Profiler::instance().begin(name) : npos) { }
+    ~ScopedTimer() noexcept {
+        if (m_index != npos) {
+            Profiler::instance().end(m_index);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&)            = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    std::size_t m_index;
+};
+
+#ifndef NPROFILER
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name)       const ScopedTimer PROFILE_CONCAT(profile_scope_, __COUNTER__)(name)
+#else
+#define PROFILE_SCOPE(name)       static_cast<void>(0)
+#endif
+
+#endif  // PROFILER_HPP
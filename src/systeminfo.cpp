@@ -0,0 +1,49 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "systeminfo.hpp"
+
+#include <sys/statvfs.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+SystemInfo::SystemInfo() noexcept {
+    struct utsname un {};
+    if (uname(&un) == 0) {
+        m_arch = un.machine;
+    }
+
+    if (const auto cores = sysconf(_SC_NPROCESSORS_ONLN); cores > 0) {
+        m_core_count = static_cast<std::uint32_t>(cores);
+    }
+
+    spdlog::debug("system: arch={} cores={}", m_arch, m_core_count);
+}
+
+auto SystemInfo::instance() noexcept -> const SystemInfo& {
+    static const SystemInfo s_info{};
+    return s_info;
+}
+
+auto SystemInfo::free_space(const std::string& path) noexcept -> std::optional<std::uint64_t> {
+    struct statvfs fs {};
+    if (statvfs(path.c_str(), &fs) != 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint64_t>(fs.f_bavail) * fs.f_frsize;
+}
@@ -0,0 +1,47 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef SYSTEMINFO_HPP
+#define SYSTEMINFO_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Facts about the running system, detected once with plain syscalls.
+class SystemInfo final {
+ public:
+    [[gnu::pure]] static const SystemInfo& instance() noexcept;
+
+    /* clang-format off */
+    auto arch() const noexcept -> std::string_view
+    { return m_arch; }
+    auto core_count() const noexcept -> std::uint32_t
+    { return m_core_count; }
+    /* clang-format on */
+
+    // free space of the filesystem holding path, e.g. a configured CacheDir, in bytes
+    static auto free_space(const std::string& path) noexcept -> std::optional<std::uint64_t>;
+
+ private:
+    SystemInfo() noexcept;
+
+    std::string m_arch{};
+    std::uint32_t m_core_count{1};
+};
+
+#endif  // SYSTEMINFO_HPP
@@ -0,0 +1,61 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "treefilter.hpp"
+
+#include <QTreeWidget>
+#include <QTreeWidgetItemIterator>
+
+void filter_tree(QTreeWidget* tree, const QString& word, int name_col, int description_col) {
+    if (word.isEmpty()) {
+        for (QTreeWidgetItemIterator it(tree); *it; ++it)
+            (*it)->setExpanded(false);
+        tree->reset();
+        for (int i = 0; i < tree->columnCount(); ++i)
+            tree->resizeColumnToContents(i);
+        return;
+    }
+    auto found_items = tree->findItems(word, Qt::MatchContains | Qt::MatchRecursive, name_col);
+    found_items << tree->findItems(word, Qt::MatchContains | Qt::MatchRecursive, description_col);
+
+    // hide/show items
+    for (QTreeWidgetItemIterator it(tree); *it; ++it) {
+        if ((*it)->childCount() == 0) {  // if child
+            if (found_items.contains(*it)) {
+                (*it)->setHidden(false);
+            } else {
+                (*it)->parent()->setHidden(true);
+                (*it)->setHidden(true);
+            }
+        }
+    }
+
+    // process found items
+    for (auto item : found_items) {
+        if (item->childCount() == 0) {  // if child, expand parent
+            item->parent()->setExpanded(true);
+            item->parent()->setHidden(false);
+        } else {  // if parent, expand children
+            item->setExpanded(true);
+            item->setHidden(false);
+            int count = item->childCount();
+            for (int i = 0; i < count; ++i)
+                item->child(i)->setHidden(false);
+        }
+    }
+    for (int i = 0; i < tree->columnCount(); ++i)
+        tree->resizeColumnToContents(i);
+}
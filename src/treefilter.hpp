@@ -0,0 +1,29 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef TREEFILTER_HPP
+#define TREEFILTER_HPP
+
+#include <QString>
+
+class QTreeWidget;
+
+// Shows the items of a category tree whose name or description contains
+// word, with their categories expanded, and hides everything else. An
+// empty word collapses the tree again.
+void filter_tree(QTreeWidget* tree, const QString& word, int name_col, int description_col);
+
+#endif  // TREEFILTER_HPP
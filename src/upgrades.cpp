@@ -0,0 +1,139 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "upgrades.hpp"
+#include "alpmlist.hpp"
+#include "systeminfo.hpp"
+#include "versionnumber.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+struct entry_t {
+    std::string_view name{};
+    std::string_view version{};
+    alpm_pkg_t* pkg{};
+};
+
+struct match_t {
+    const entry_t* local{};
+    const entry_t* sync{};
+};
+
+constexpr auto by_name = [](const entry_t& lhs, const entry_t& rhs) { return lhs.name < rhs.name; };
+
+// every package of db, sorted by name
+std::vector<entry_t> collect(alpm_db_t* db) {
+    std::vector<entry_t> entries{};
+    for (auto* pkg : alpm::list_view<alpm_pkg_t>{alpm_db_get_pkgcache(db)}) {
+        entries.push_back({alpm_pkg_get_name(pkg), alpm_pkg_get_version(pkg), pkg});
+    }
+    // libalpm sorts its package caches by name, only sort if that ever changes
+    if (!std::is_sorted(entries.begin(), entries.end(), by_name)) {
+        std::sort(entries.begin(), entries.end(), by_name);
+    }
+    return entries;
+}
+
+// merge-join of local[first, last) against every database, the databases
+// are in pacman.conf order so the first one carrying a name wins
+void join_chunk(const std::vector<entry_t>& local, std::size_t first, std::size_t last, const std::vector<std::vector<entry_t>>& syncdbs, std::vector<match_t>& matches) {
+    std::vector<std::vector<entry_t>::const_iterator> cursors{};
+    cursors.reserve(syncdbs.size());
+    for (const auto& db : syncdbs) {
+        cursors.push_back(std::lower_bound(db.begin(), db.end(), local[first], by_name));
+    }
+
+    for (auto i = first; i < last; ++i) {
+        const auto& pkg = local[i];
+        for (std::size_t db = 0; db < syncdbs.size(); ++db) {
+            auto& cursor = cursors[db];
+            cursor       = std::lower_bound(cursor, syncdbs[db].end(), pkg, by_name);
+            if (cursor == syncdbs[db].end() || cursor->name != pkg.name) {
+                continue;
+            }
+            if (VersionNumber{cursor->version} > VersionNumber{pkg.version}) {
+                matches.push_back({&pkg, &*cursor});
+            }
+            break;
+        }
+    }
+}
+}  // namespace
+
+auto find_upgrades(alpm_handle_t* handle) -> UpgradeReport {
+    const auto local = collect(alpm_get_localdb(handle));
+
+    std::vector<std::vector<entry_t>> syncdbs{};
+    for (auto* db : alpm::list_view<alpm_db_t>{alpm_get_syncdbs(handle)}) {
+        int usage{};
+        alpm_db_get_usage(db, &usage);
+        if ((usage & ALPM_DB_USAGE_UPGRADE) != 0) {
+            syncdbs.emplace_back(collect(db));
+        }
+    }
+
+    // the chunks are joined independently, their results concatenate in name order
+    static constexpr std::size_t chunk_size = 256;
+    const auto chunk_count  = (local.size() + chunk_size - 1) / chunk_size;
+    const auto max_workers  = std::clamp<std::size_t>(chunk_count, 1, 8);
+    const auto worker_count = std::clamp<std::size_t>(SystemInfo::instance().core_count(), 1, max_workers);
+
+    std::vector<std::vector<match_t>> chunk_matches(chunk_count);
+    std::atomic<std::size_t> next{};
+    const auto& worker = [&] {
+        for (auto chunk = next++; chunk < chunk_count; chunk = next++) {
+            const auto first = chunk * chunk_size;
+            join_chunk(local, first, std::min(first + chunk_size, local.size()), syncdbs, chunk_matches[chunk]);
+        }
+    };
+
+    std::vector<std::jthread> workers{};
+    workers.reserve(worker_count - 1);
+    for (std::size_t i = 1; i < worker_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    workers.clear();
+
+    // libalpm loads package details lazily and isn't thread-safe, sizes are read here
+    UpgradeReport report{};
+    for (const auto& matches : chunk_matches) {
+        for (const auto& [local_pkg, sync_pkg] : matches) {
+            if (alpm_pkg_should_ignore(handle, local_pkg->pkg) || alpm_pkg_should_ignore(handle, sync_pkg->pkg)) {
+                spdlog::info("ignoring package upgrade {} ({} => {})", local_pkg->name, local_pkg->version, sync_pkg->version);
+                continue;
+            }
+            auto& upgrade                 = report.upgrades.emplace_back();
+            upgrade.local                 = local_pkg->pkg;
+            upgrade.sync                  = sync_pkg->pkg;
+            upgrade.name                  = local_pkg->name;
+            upgrade.old_version           = local_pkg->version;
+            upgrade.new_version           = sync_pkg->version;
+            upgrade.repo                  = alpm_db_get_name(alpm_pkg_get_db(sync_pkg->pkg));
+            upgrade.download_size         = alpm_pkg_download_size(sync_pkg->pkg);
+            upgrade.installed_size_change = alpm_pkg_get_isize(sync_pkg->pkg) - alpm_pkg_get_isize(local_pkg->pkg);
+
+            report.download_size += upgrade.download_size;
+            report.installed_size_change += upgrade.installed_size_change;
+        }
+    }
+    return report;
+}
@@ -0,0 +1,51 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef UPGRADES_HPP
+#define UPGRADES_HPP
+
+#include <alpm.h>
+#include <sys/types.h>
+
+#include <string_view>
+#include <vector>
+
+struct PackageUpgrade {
+    alpm_pkg_t* local{};
+    alpm_pkg_t* sync{};
+    // owned by libalpm, valid as long as the handle
+    std::string_view name{};
+    std::string_view old_version{};
+    std::string_view new_version{};
+    std::string_view repo{};
+    off_t download_size{};  // 0 if the package is in the cache already
+    off_t installed_size_change{};
+};
+
+struct UpgradeReport {
+    std::vector<PackageUpgrade> upgrades{};  // sorted by name
+    off_t download_size{};
+    off_t installed_size_change{};
+};
+
+// Installed packages with a newer version in the sync databases, picked
+// the way pacman -Su does: the first database carrying the name wins,
+// IgnorePkg/IgnoreGroup and databases without Upgrade usage are skipped.
+// The local and sync package lists are merge-joined by name, the version
+// comparisons of the matches run on a few worker threads.
+auto find_upgrades(alpm_handle_t* handle) -> UpgradeReport;
+
+#endif  // UPGRADES_HPP
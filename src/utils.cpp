@@ -134,4 +134,14 @@ auto make_multiline(const std::vector<std::string_view>& multiline, bool reverse
     return res;
 }
 
+std::size_t replace_all(std::string& inout, const std::string_view& what, const std::string_view& with) noexcept {
+    std::size_t count{};
+    std::size_t pos{};
+    while (std::string::npos != (pos = inout.find(what.data(), pos, what.length()))) {
+        inout.replace(pos, what.length(), with.data(), with.length());
+        pos += with.length(), ++count;
+    }
+    return count;
+}
+
 }  // namespace utils
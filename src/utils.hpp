@@ -17,9 +17,8 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
-#include "versionnumber.hpp"
-
 #include <algorithm>  // for transform
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -104,6 +103,8 @@ auto make_multiline(const std::string_view& str, bool reverse, const std::string
 
 auto make_multiline(const std::vector<std::string_view>& multiline, bool reverse, const std::string_view&& delim) noexcept -> std::string;
 
+std::size_t replace_all(std::string& inout, const std::string_view& what, const std::string_view& with) noexcept;
+
 template <std::input_iterator I, std::sentinel_for<I> S>
 auto make_multiline_range(I first, S last, bool reverse, const std::string_view&& delim) noexcept -> std::string {
     std::string res{};
@@ -0,0 +1,180 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "versionnumber.hpp"
+
+namespace {
+// ASCII classes, libalpm's isdigit/isalpha see the same in a UTF-8 locale
+constexpr bool is_digit(char ch) noexcept { return ch >= '0' && ch <= '9'; }
+constexpr bool is_alpha(char ch) noexcept { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+constexpr bool is_alnum(char ch) noexcept { return is_digit(ch) || is_alpha(ch); }
+
+// what rpmvercmp's final comparison looks at: the character its cursor stopped on
+enum class stop_t : std::uint8_t {
+    end,
+    alpha,
+    other
+};
+
+// a remaining alpha string must never beat an empty one
+int showdown(stop_t first, stop_t second) noexcept {
+    if (first == stop_t::end && second == stop_t::end) {
+        return 0;
+    }
+    if ((first == stop_t::end && second != stop_t::alpha) || first == stop_t::alpha) {
+        return -1;
+    }
+    return 1;
+}
+}  // namespace
+
+// Same split as libalpm's parseEVR: the epoch is a run of digits before
+// ':', the release follows the last '-'.
+void VersionNumber::parse() {
+    m_segments.clear();
+    const std::string_view evr{str};
+
+    std::size_t pos{};
+    while (pos < evr.size() && is_digit(evr[pos])) {
+        ++pos;
+    }
+    const auto dash = evr.rfind('-');
+    m_has_release   = (dash != std::string_view::npos && dash >= pos);
+
+    std::size_t version_begin{};
+    m_epoch = segment_t{0, 0, 0, true};
+    if (pos < evr.size() && evr[pos] == ':') {
+        auto digits = evr.substr(0, pos);
+        while (!digits.empty() && digits.front() == '0') {
+            digits.remove_prefix(1);
+        }
+        m_epoch.offset = static_cast<std::uint32_t>(pos - digits.size());
+        m_epoch.length = static_cast<std::uint32_t>(digits.size());
+        version_begin  = pos + 1;
+    }
+
+    const auto version_end = m_has_release ? dash : evr.size();
+    parse_part(m_version, version_begin, version_end);
+    if (m_has_release) {
+        parse_part(m_release, dash + 1, evr.size());
+    } else {
+        m_release = part_t{};
+    }
+}
+
+void VersionNumber::parse_part(part_t& part, std::size_t begin, std::size_t end) {
+    part.first = static_cast<std::uint32_t>(m_segments.size());
+
+    std::size_t separators{};
+    for (std::size_t pos = begin; pos < end;) {
+        if (!is_alnum(str[pos])) {
+            ++separators;
+            ++pos;
+            continue;
+        }
+
+        const bool numeric = is_digit(str[pos]);
+        const auto start   = pos;
+        while (pos < end && (numeric ? is_digit(str[pos]) : is_alpha(str[pos]))) {
+            ++pos;
+        }
+        auto offset = start;
+        if (numeric) {
+            while (offset < pos && str[offset] == '0') {
+                ++offset;
+            }
+        }
+        m_segments.push_back({static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(pos - offset), static_cast<std::uint32_t>(separators), numeric});
+        separators = 0;
+    }
+
+    part.count    = static_cast<std::uint32_t>(m_segments.size()) - part.first;
+    part.trailing = static_cast<std::uint32_t>(separators);
+}
+
+int VersionNumber::compare_numbers(std::string_view first, std::string_view second) noexcept {
+    // no leading zeros, the longer number is bigger
+    if (first.size() != second.size()) {
+        return (first.size() < second.size()) ? -1 : 1;
+    }
+    const int rc = first.compare(second);
+    return (rc < 0) ? -1 : (rc > 0) ? 1 : 0;
+}
+
+// rpmvercmp, replayed on the segments
+int VersionNumber::compare_part(const VersionNumber& first, const part_t& first_part, const VersionNumber& second, const part_t& second_part) noexcept {
+    // where the cursor of one string stands before and after skipping the separators of segment i
+    const auto stop_before = [](const VersionNumber& ver, const part_t& part, std::uint32_t i) {
+        if (i == part.count) {
+            return (part.trailing != 0) ? stop_t::other : stop_t::end;
+        }
+        const auto& segment = ver.m_segments[part.first + i];
+        if (segment.separators != 0 || segment.numeric) {
+            return stop_t::other;
+        }
+        return stop_t::alpha;
+    };
+    const auto stop_after = [](const VersionNumber& ver, const part_t& part, std::uint32_t i) {
+        if (i == part.count) {
+            return stop_t::end;
+        }
+        return ver.m_segments[part.first + i].numeric ? stop_t::other : stop_t::alpha;
+    };
+
+    for (std::uint32_t i = 0;; ++i) {
+        const auto first_stop  = stop_before(first, first_part, i);
+        const auto second_stop = stop_before(second, second_part, i);
+        if (first_stop == stop_t::end || second_stop == stop_t::end) {
+            return showdown(first_stop, second_stop);
+        }
+        if (i == first_part.count || i == second_part.count) {
+            return showdown(stop_after(first, first_part, i), stop_after(second, second_part, i));
+        }
+
+        const auto& lhs = first.m_segments[first_part.first + i];
+        const auto& rhs = second.m_segments[second_part.first + i];
+        if (lhs.separators != rhs.separators) {
+            return (lhs.separators < rhs.separators) ? -1 : 1;
+        }
+        // a number is newer than letters
+        if (lhs.numeric != rhs.numeric) {
+            return lhs.numeric ? 1 : -1;
+        }
+
+        int rc{};
+        if (lhs.numeric) {
+            rc = compare_numbers(first.value(lhs), second.value(rhs));
+        } else {
+            const int cmp = first.value(lhs).compare(second.value(rhs));
+            rc            = (cmp < 0) ? -1 : (cmp > 0) ? 1 : 0;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+    }
+}
+
+int VersionNumber::compare(const VersionNumber& first, const VersionNumber& second) noexcept {
+    int ret = compare_numbers(first.value(first.m_epoch), second.value(second.m_epoch));
+    if (ret == 0) {
+        ret = compare_part(first, first.m_version, second, second.m_version);
+    }
+    // the release only counts if both have one
+    if (ret == 0 && first.m_has_release && second.m_has_release) {
+        ret = compare_part(first, first.m_release, second, second.m_release);
+    }
+    return ret;
+}
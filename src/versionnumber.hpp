@@ -17,55 +17,74 @@
 #ifndef VERSIONNUMBER_HPP
 #define VERSIONNUMBER_HPP
 
-#include <alpm.h>
-
+#include <compare>
+#include <cstdint>
+#include <string>
 #include <string_view>
-
-#include <QMetaType>
-#include <QString>
-#include <QStringView>
+#include <type_traits>
+#include <vector>
 
 #include <fmt/core.h>
 
+// Package version ([epoch:]version[-release]) which orders exactly like
+// alpm_pkg_vercmp. The string is split into its segments once, comparing
+// then walks the segments without parsing or allocating again.
 class VersionNumber final {
  public:
-    VersionNumber() noexcept                           = default;
-    VersionNumber(const VersionNumber& value) noexcept = default;  // copy constructor
-    explicit VersionNumber(const std::string_view& value) noexcept : str(value) { }
+    VersionNumber() noexcept = default;
+    VersionNumber(const VersionNumber& value)     = default;  // copy constructor
+    VersionNumber(VersionNumber&& value) noexcept = default;
+    explicit VersionNumber(const std::string_view& value) : str(value) { parse(); }
     ~VersionNumber() noexcept = default;
 
-    [[nodiscard]] std::string_view toStringView() const noexcept { return str.c_str(); }
+    [[nodiscard]] std::string_view toStringView() const noexcept { return str; }
     [[nodiscard]] std::string toString() const noexcept { return str; }
-    [[nodiscard]] QStringView toQStringView() const noexcept { return {reinterpret_cast<const QChar*>(str.c_str())}; }
-    [[nodiscard]] QString toQString() const noexcept { return {str.c_str()}; }
 
-    VersionNumber& operator=(const VersionNumber& value) noexcept = default;
+    VersionNumber& operator=(const VersionNumber& value) = default;
+    VersionNumber& operator=(VersionNumber&& value) noexcept = default;
 
     // Operators
     /* clang-format off */
-    inline bool operator<(const VersionNumber& value) const noexcept
-    { return (compare(*this, value) == -1); }
-    inline bool operator<=(const VersionNumber& value) const noexcept
-    { return !(*this > value); }
-    inline bool operator>(const VersionNumber& value) const noexcept
-    { return (compare(*this, value) == 1); }
-    inline bool operator>=(const VersionNumber& value) const noexcept
-    { return !(*this < value); }
+    inline std::weak_ordering operator<=>(const VersionNumber& value) const noexcept
+    { return compare(*this, value) <=> 0; }
+    // versions can be equal without being the same string, e.g. "1.01" and "1.1"
     inline bool operator==(const VersionNumber& value) const noexcept
-    { return (compare(*this, value) == 0); }
-    inline bool operator!=(const VersionNumber& value) const noexcept
-    { return !(*this == value); }
+    { return compare(*this, value) == 0; }
     /* clang-format on */
 
+    // -1, 0 or 1 like alpm_pkg_vercmp
+    [[nodiscard]] static int compare(const VersionNumber& first, const VersionNumber& second) noexcept;
+
  private:
-    std::string str{};  // full version string
+    // maximal run of digits or letters, digits are stored without leading zeros
+    struct segment_t {
+        std::uint32_t offset{};
+        std::uint32_t length{};
+        std::uint32_t separators{};  // non-alphanumeric characters before it
+        bool numeric{};
+    };
+    // version or release
+    struct part_t {
+        std::uint32_t first{};
+        std::uint32_t count{};
+        std::uint32_t trailing{};  // separators after the last segment
+    };
 
-    // -1 for >second, 1 for <second, 0 for equal
-    [[nodiscard]] static inline int compare(const char* first, const char* second) noexcept { return alpm_pkg_vercmp(first, second); }
-    [[nodiscard]] static inline int compare(const VersionNumber& first, const VersionNumber& second) noexcept { return compare(first.str.c_str(), second.str.c_str()); }
-};
+    void parse();
+    void parse_part(part_t& part, std::size_t begin, std::size_t end);
+    static int compare_numbers(std::string_view first, std::string_view second) noexcept;
+    static int compare_part(const VersionNumber& first, const part_t& first_part, const VersionNumber& second, const part_t& second_part) noexcept;
+
+    auto value(const segment_t& segment) const noexcept -> std::string_view
+    { return std::string_view{str}.substr(segment.offset, segment.length); }
 
-Q_DECLARE_METATYPE(VersionNumber)
+    std::string str{};  // full version string
+    std::vector<segment_t> m_segments{};
+    segment_t m_epoch{0, 0, 0, true};  // always numeric, "0" if there is none
+    part_t m_version{};
+    part_t m_release{};
+    bool m_has_release{};
+};
 
 // Custom formatter
 template <typename T>
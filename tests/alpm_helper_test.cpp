@@ -0,0 +1,192 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// alpm_helper against generated databases in a temporary root, so
+// resolving, committing and removing never touch the host.
+
+#include "alpm_helper.hpp"
+#include "alpmlist.hpp"
+#include "fakedb.hpp"
+#include "journal.hpp"
+
+#include <filesystem>
+
+#include <gtest/gtest.h>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+class AlpmHelperTest : public ::testing::Test {
+ protected:
+    static void SetUpTestSuite() { spdlog::set_level(spdlog::level::warn); }
+
+    void SetUp() override {
+        ASSERT_FALSE(m_root.root().empty());
+        TransactionJournal::instance().set_path(m_root.root() + "/transaction.journal");
+    }
+
+    void TearDown() override {
+        destroy_alpm(m_handle);
+        TransactionJournal::instance().set_path(journal_path);
+    }
+
+    // (re)opens the handle, as the app does after every transaction
+    alpm_handle_t* open() {
+        alpm_errno_t err{};
+        refresh_alpm(&m_handle, &err, m_root.write_conf());
+        EXPECT_NE(m_handle, nullptr) << alpm_strerror(err);
+        return m_handle;
+    }
+
+    bool owns_file(std::string_view name) const {
+        return fs::exists(fmt::format("{0}/usr/share/{1}/{1}.txt", m_root.root(), name));
+    }
+
+    FakeRoot m_root{};
+    alpm_handle_t* m_handle{};
+};
+
+std::size_t count_packages(alpm_db_t* db) {
+    return alpm_list_count(alpm_db_get_pkgcache(db));
+}
+
+TEST_F(AlpmHelperTest, InitLoadsDatabasesAtScale) {
+    const auto& core = generate_packages({.count = 20000, .dep_depth = 3});
+    ASSERT_TRUE(m_root.add_sync_db("core", core));
+    ASSERT_TRUE(m_root.add_sync_db("extra", generate_packages({.count = 20000, .prefix = "lib", .seed = 2})));
+    ASSERT_TRUE(m_root.add_local({core.begin(), core.begin() + 2000}));
+
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+    const auto& syncdbs = alpm::list_view<alpm_db_t>{alpm_get_syncdbs(handle)};
+    ASSERT_EQ(alpm_list_count(alpm_get_syncdbs(handle)), 2U);
+    for (auto* db : syncdbs) {
+        EXPECT_EQ(count_packages(db), 20000U) << alpm_db_get_name(db);
+    }
+    EXPECT_EQ(count_packages(alpm_get_localdb(handle)), 2000U);
+    EXPECT_TRUE(is_target_installed(handle, "pkg01999"));
+    EXPECT_FALSE(is_target_installed(handle, "pkg02000"));
+}
+
+TEST_F(AlpmHelperTest, SyncTransResolvesTargets) {
+    ASSERT_TRUE(m_root.add_sync_db("core", generate_packages({.count = 20000, .dep_depth = 5})));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    std::string conflict_msg{};
+    EXPECT_EQ(sync_trans(handle, {"pkg00100", "pkg10000"}, ALPM_TRANS_FLAG_NEEDED, conflict_msg), 0);
+    EXPECT_TRUE(conflict_msg.empty()) << conflict_msg;
+    EXPECT_NE(sync_trans(handle, {"no-such-package"}, ALPM_TRANS_FLAG_NEEDED, conflict_msg), 0);
+}
+
+TEST_F(AlpmHelperTest, DisplayTargetsListsDependencies) {
+    ASSERT_TRUE(m_root.add_sync_db("core", generate_packages({.count = 20000, .dep_depth = 5})));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    InstallPlan plan{};
+    // pkg00102 starts a chain of six
+    plan.add_app("app", {"pkg00102"});
+    const auto& preview = plan.prepare(handle, ALPM_TRANS_FLAG_NEEDED);
+    ASSERT_TRUE(preview.ok) << preview.conflict_msg;
+    for (int i = 102; i <= 107; ++i) {
+        EXPECT_NE(preview.details.find(fmt::format("pkg{:05}", i)), std::string::npos) << preview.details;
+    }
+    EXPECT_EQ(preview.details.find("pkg00108"), std::string::npos) << preview.details;
+    EXPECT_FALSE(preview.summary.empty());
+    plan.release();
+
+    // a dry run resolves the same way and leaves the system alone
+    std::string error_msg{};
+    EXPECT_EQ(commit_trans(handle, {"pkg00102"}, {}, ALPM_TRANS_FLAG_NEEDED, error_msg, true), 0) << error_msg;
+    EXPECT_FALSE(is_target_installed(handle, "pkg00102"));
+}
+
+TEST_F(AlpmHelperTest, ConflictsNeedConsent) {
+    // pkg00009 conflicts with and provides pkg00008
+    const auto& pkgs = generate_packages({.count = 100, .conflict_every = 10});
+    ASSERT_TRUE(m_root.add_sync_db("core", pkgs));
+    ASSERT_TRUE(m_root.add_local({pkgs[8]}));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    InstallPlan plan{};
+    plan.add_app("app", {"pkg00009"});
+    const auto& refused = plan.prepare(handle, ALPM_TRANS_FLAG_NEEDED);
+    EXPECT_FALSE(refused.ok);
+    EXPECT_NE(refused.conflict_msg.find("pkg00008"), std::string::npos) << refused.conflict_msg;
+
+    const auto& accepted = plan.prepare(handle, ALPM_TRANS_FLAG_NEEDED, true);
+    EXPECT_TRUE(accepted.ok) << accepted.conflict_msg;
+    plan.release();
+}
+
+TEST_F(AlpmHelperTest, RemoveDeletesPackageFiles) {
+    const auto& pkgs = generate_packages({.count = 10});
+    ASSERT_TRUE(m_root.add_sync_db("core", pkgs));
+    ASSERT_TRUE(m_root.add_local(pkgs));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    std::string error_msg{};
+    ASSERT_EQ(commit_trans(handle, {}, {"pkg00003"}, 0, error_msg), 0) << error_msg;
+    handle = open();
+    EXPECT_FALSE(is_target_installed(handle, "pkg00003"));
+    EXPECT_FALSE(owns_file("pkg00003"));
+    EXPECT_TRUE(is_target_installed(handle, "pkg00004"));
+    EXPECT_TRUE(owns_file("pkg00004"));
+    EXPECT_FALSE(TransactionJournal::instance().pending());
+}
+
+TEST_F(AlpmHelperTest, InstallCommitsIntoRoot) {
+    ASSERT_TRUE(m_root.add_sync_db("core", generate_packages({.count = 50, .dep_depth = 2}), true));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    // pkg00009 starts a chain of three
+    std::string error_msg{};
+    ASSERT_EQ(commit_trans(handle, {"pkg00009"}, {}, ALPM_TRANS_FLAG_NEEDED, error_msg), 0) << error_msg;
+    handle = open();
+    for (const auto* name : {"pkg00009", "pkg00010", "pkg00011"}) {
+        EXPECT_TRUE(is_target_installed(handle, name)) << name;
+        EXPECT_TRUE(owns_file(name)) << name;
+    }
+    auto* dep = alpm_db_get_pkg(alpm_get_localdb(handle), "pkg00010");
+    ASSERT_NE(dep, nullptr);
+    EXPECT_EQ(alpm_pkg_get_reason(dep), ALPM_PKG_REASON_DEPEND);
+    EXPECT_FALSE(is_target_installed(handle, "pkg00012"));
+    EXPECT_FALSE(TransactionJournal::instance().pending());
+}
+
+TEST_F(AlpmHelperTest, InstallAndRemoveInOneCommit) {
+    const auto& pkgs = generate_packages({.count = 30});
+    ASSERT_TRUE(m_root.add_sync_db("core", pkgs, true));
+    ASSERT_TRUE(m_root.add_local({pkgs[3]}));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    // both kinds of targets share the transaction commit_trans opened
+    std::string error_msg{};
+    ASSERT_EQ(commit_trans(handle, {"pkg00020"}, {"pkg00003", "not-installed"}, ALPM_TRANS_FLAG_NEEDED, error_msg), 0) << error_msg;
+    handle = open();
+    EXPECT_TRUE(is_target_installed(handle, "pkg00020"));
+    EXPECT_TRUE(owns_file("pkg00020"));
+    EXPECT_FALSE(is_target_installed(handle, "pkg00003"));
+    EXPECT_FALSE(owns_file("pkg00003"));
+    EXPECT_FALSE(TransactionJournal::instance().pending());
+}
+}  // namespace
@@ -0,0 +1,312 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "fakedb.hpp"
+
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+// ustar, the subset libarchive needs to read a repo-add database
+class TarWriter final {
+ public:
+    explicit TarWriter(const std::string& path) : m_file(path, std::ios::binary) { }
+
+    void add_dir(std::string_view name) { write_header(fmt::format("{}/", name), 0, '5'); }
+    void add_file(std::string_view name, std::string_view content) {
+        write_header(name, content.size(), '0');
+        m_file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        pad(content.size());
+    }
+
+    // two zero blocks end the archive
+    bool finish() {
+        static constexpr std::array<char, 1024> eof{};
+        m_file.write(eof.data(), eof.size());
+        m_file.close();
+        return !m_file.fail();
+    }
+
+ private:
+    static constexpr std::size_t block_size = 512;
+
+    void write_header(std::string_view name, std::size_t size, char type) {
+        std::array<char, block_size> header{};
+        std::memcpy(header.data(), name.data(), std::min<std::size_t>(name.size(), 100));
+        std::snprintf(&header[100], 8, "%07o", (type == '5') ? 0755U : 0644U);
+        std::snprintf(&header[108], 8, "%07o", 0U);
+        std::snprintf(&header[116], 8, "%07o", 0U);
+        std::snprintf(&header[124], 12, "%011zo", size);
+        std::snprintf(&header[136], 12, "%011o", 0U);
+        header[156] = type;
+        std::memcpy(&header[257], "ustar", 6);
+        std::memcpy(&header[263], "00", 2);
+
+        // the checksum is computed with its own field filled with spaces
+        std::memset(&header[148], ' ', 8);
+        unsigned int checksum{};
+        for (const char ch : header) {
+            checksum += static_cast<unsigned char>(ch);
+        }
+        std::snprintf(&header[148], 8, "%06o", checksum);
+        header[155] = ' ';
+        m_file.write(header.data(), header.size());
+    }
+
+    void pad(std::size_t size) {
+        static constexpr std::array<char, block_size> zeros{};
+        if (const auto rest = size % block_size; rest != 0) {
+            m_file.write(zeros.data(), static_cast<std::streamsize>(block_size - rest));
+        }
+    }
+
+    std::ofstream m_file;
+};
+
+// plain tar, libarchive detects the format on its own
+std::string package_filename(const FakePackage& pkg) {
+    return fmt::format("{}-{}-{}.pkg.tar", pkg.name, pkg.version, pkg.arch);
+}
+
+std::string owned_file(const FakePackage& pkg) {
+    return fmt::format("usr/share/{0}/{0}.txt", pkg.name);
+}
+
+void add_field(std::string& out, std::string_view field, std::string_view value) {
+    out += fmt::format("%{}%\n{}\n\n", field, value);
+}
+
+void add_list(std::string& out, std::string_view field, const std::vector<std::string>& values) {
+    if (values.empty()) {
+        return;
+    }
+    out += fmt::format("%{}%\n", field);
+    for (const auto& value : values) {
+        out += value;
+        out += '\n';
+    }
+    out += '\n';
+}
+
+std::string make_desc(const FakePackage& pkg, bool local) {
+    std::string desc{};
+    if (!local) {
+        add_field(desc, "FILENAME", package_filename(pkg));
+    }
+    add_field(desc, "NAME", pkg.name);
+    add_field(desc, "VERSION", pkg.version);
+    add_field(desc, "BASE", pkg.name);
+    add_field(desc, "DESC", pkg.desc);
+    add_list(desc, "GROUPS", pkg.groups);
+    if (!local) {
+        add_field(desc, "CSIZE", std::to_string(pkg.csize));
+        add_field(desc, "ISIZE", std::to_string(pkg.isize));
+    } else {
+        add_field(desc, "SIZE", std::to_string(pkg.isize));
+    }
+    add_field(desc, "ARCH", pkg.arch);
+    add_field(desc, "BUILDDATE", "1660000000");
+    if (local) {
+        add_field(desc, "INSTALLDATE", "1660000000");
+        if (pkg.as_dependency) {
+            add_field(desc, "REASON", "1");
+        }
+    }
+    add_field(desc, "PACKAGER", "Fake Packager <fake@localhost>");
+    add_list(desc, "DEPENDS", pkg.depends);
+    add_list(desc, "CONFLICTS", pkg.conflicts);
+    add_list(desc, "PROVIDES", pkg.provides);
+    return desc;
+}
+
+std::string make_pkginfo(const FakePackage& pkg) {
+    std::string pkginfo = fmt::format(
+        "pkgname = {0}\npkgbase = {0}\npkgver = {1}\npkgdesc = {2}\nbuilddate = 1660000000\n"
+        "packager = Fake Packager <fake@localhost>\nsize = {3}\narch = {4}\n",
+        pkg.name, pkg.version, pkg.desc, pkg.isize, pkg.arch);
+    for (const auto& [key, values] : {std::pair{"group", &pkg.groups}, std::pair{"depend", &pkg.depends},
+             std::pair{"conflict", &pkg.conflicts}, std::pair{"provides", &pkg.provides}}) {
+        for (const auto& value : *values) {
+            pkginfo += fmt::format("{} = {}\n", key, value);
+        }
+    }
+    return pkginfo;
+}
+
+bool write_file(const fs::path& path, std::string_view content) {
+    std::ofstream file{path};
+    file << content;
+    return static_cast<bool>(file);
+}
+
+// returns the size of the archive, -1 on failure
+off_t write_package(const fs::path& dir, const FakePackage& pkg) {
+    const auto& path = dir / package_filename(pkg);
+    const auto& file = owned_file(pkg);
+
+    TarWriter archive{path.string()};
+    archive.add_file(".PKGINFO", make_pkginfo(pkg));
+    archive.add_dir("usr");
+    archive.add_dir("usr/share");
+    archive.add_dir(fmt::format("usr/share/{}", pkg.name));
+    archive.add_file(file, pkg.desc);
+    if (!archive.finish()) {
+        return -1;
+    }
+    std::error_code ec{};
+    const auto size = fs::file_size(path, ec);
+    return ec ? -1 : static_cast<off_t>(size);
+}
+}  // namespace
+
+FakeRoot::FakeRoot() {
+    auto tmpl = (fs::temp_directory_path() / "cachyos-pi-fakeroot.XXXXXX").string();
+    if (::mkdtemp(tmpl.data()) == nullptr) {
+        return;
+    }
+    m_root = std::move(tmpl);
+
+    std::error_code ec{};
+    for (const auto* dir : {"/var/lib/pacman/sync", "/var/lib/pacman/local", "/var/cache/pacman/pkg", "/var/log", "/etc/pacman.d/hooks"}) {
+        fs::create_directories(m_root + dir, ec);
+    }
+    // an empty local database is created with the current version on first use
+    write_file(dbpath() + "/local/ALPM_DB_VERSION", "9\n");
+}
+
+FakeRoot::~FakeRoot() {
+    if (!m_root.empty()) {
+        std::error_code ec{};
+        fs::remove_all(m_root, ec);
+    }
+}
+
+bool FakeRoot::add_sync_db(std::string_view repo, std::vector<FakePackage> pkgs, bool with_archives) {
+    if (m_root.empty()) {
+        return false;
+    }
+
+    if (with_archives) {
+        const fs::path dir = fmt::format("{}/repo/{}", m_root, repo);
+        std::error_code ec{};
+        fs::create_directories(dir, ec);
+        for (auto& pkg : pkgs) {
+            // libalpm refuses downloads bigger than the database says
+            pkg.csize = write_package(dir, pkg);
+            if (ec || pkg.csize < 0) {
+                return false;
+            }
+        }
+    }
+
+    TarWriter db{fmt::format("{}/sync/{}.db", dbpath(), repo)};
+    for (const auto& pkg : pkgs) {
+        const auto& dir = fmt::format("{}-{}", pkg.name, pkg.version);
+        db.add_dir(dir);
+        db.add_file(dir + "/desc", make_desc(pkg, false));
+    }
+    if (!db.finish()) {
+        return false;
+    }
+    m_repos.emplace_back(repo);
+    return true;
+}
+
+bool FakeRoot::add_local(const std::vector<FakePackage>& pkgs) {
+    if (m_root.empty()) {
+        return false;
+    }
+
+    for (const auto& pkg : pkgs) {
+        const fs::path dir = fmt::format("{}/local/{}-{}", dbpath(), pkg.name, pkg.version);
+        std::error_code ec{};
+        fs::create_directories(dir, ec);
+        const auto& file  = owned_file(pkg);
+        const auto& files = fmt::format("%FILES%\nusr/\nusr/share/\nusr/share/{}/\n{}\n\n", pkg.name, file);
+        if (ec || !write_file(dir / "desc", make_desc(pkg, true)) || !write_file(dir / "files", files)) {
+            return false;
+        }
+
+        const fs::path owned = fmt::format("{}/{}", m_root, file);
+        fs::create_directories(owned.parent_path(), ec);
+        if (ec || !write_file(owned, pkg.desc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto FakeRoot::write_conf() const -> std::string {
+    std::string conf = fmt::format(
+        "[options]\n"
+        "RootDir = {0}\n"
+        "DBPath = {0}/var/lib/pacman/\n"
+        "CacheDir = {0}/var/cache/pacman/pkg/\n"
+        "LogFile = {0}/var/log/pacman.log\n"
+        "GPGDir = {0}/etc/pacman.d/gnupg/\n"
+        "HookDir = {0}/etc/pacman.d/hooks/\n"
+        "Architecture = auto\n"
+        "SigLevel = Never\n",
+        m_root);
+    for (const auto& repo : m_repos) {
+        conf += fmt::format("\n[{}]\nServer = file://{}/repo/$repo\n", repo, m_root);
+    }
+
+    const auto& path = m_root + "/pacman.conf";
+    write_file(path, conf);
+    return path;
+}
+
+auto generate_packages(const FakeDbSpec& spec) -> std::vector<FakePackage> {
+    static constexpr std::array words{"editor", "browser", "kernel", "player", "library", "terminal", "compiler", "font", "theme", "driver"};
+
+    const auto name = [&spec](std::size_t i) { return fmt::format("{}{:05}", spec.prefix, i); };
+
+    std::mt19937 rng{spec.seed};
+    std::uniform_int_distribution<unsigned int> part{0, 30};
+    std::uniform_int_distribution<off_t> size{1 << 10, 1 << 26};
+
+    std::vector<FakePackage> pkgs(spec.count);
+    for (std::size_t i = 0; i < spec.count; ++i) {
+        auto& pkg   = pkgs[i];
+        pkg.name    = name(i);
+        pkg.version = fmt::format("{}.{}.{}-{}", part(rng), part(rng), part(rng), part(rng) % 4 + 1);
+        if (i % 50 == 0) {
+            pkg.version.insert(0, "1:");
+        }
+        pkg.desc  = fmt::format("Synthetic {} number {}", words[i % words.size()], i);
+        pkg.csize = size(rng);
+        pkg.isize = pkg.csize * 3;
+        if ((i + 1) % (spec.dep_depth + 1) != 0 && i + 1 < spec.count) {
+            pkg.depends.emplace_back(name(i + 1));
+        }
+        if (spec.conflict_every != 0 && i % spec.conflict_every == spec.conflict_every - 1 && i > spec.dep_depth) {
+            const auto& other = name(i - spec.dep_depth - 1);
+            pkg.conflicts.emplace_back(other);
+            pkg.provides.emplace_back(other);
+        }
+    }
+    return pkgs;
+}
@@ -0,0 +1,88 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef FAKEDB_HPP
+#define FAKEDB_HPP
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A package as the database files describe it, arch "any" installs anywhere.
+struct FakePackage {
+    std::string name{};
+    std::string version{"1.0-1"};
+    std::string desc{};
+    std::string arch{"any"};
+    std::vector<std::string> depends{};
+    std::vector<std::string> provides{};
+    std::vector<std::string> conflicts{};
+    std::vector<std::string> groups{};
+    off_t csize{};
+    off_t isize{};
+    bool as_dependency{};  // install reason in the local database
+};
+
+// Throwaway pacman root in a temporary directory: sync databases are
+// written as tarred desc files the way repo-add does, the local database as
+// plain directories, and pacman.conf points libalpm at both.
+// Everything is removed again when the root goes out of scope.
+class FakeRoot final {
+ public:
+    FakeRoot();
+    ~FakeRoot();
+
+    FakeRoot(const FakeRoot&)            = delete;
+    FakeRoot& operator=(const FakeRoot&) = delete;
+
+    // <root>/var/lib/pacman/sync/<repo>.db, repositories are added to pacman.conf in call order.
+    // with_archives also writes installable packages to <root>/repo/<repo>/, each owning
+    // usr/share/<name>/<name>.txt, so transactions can be committed
+    bool add_sync_db(std::string_view repo, std::vector<FakePackage> pkgs, bool with_archives = false);
+    // <root>/var/lib/pacman/local/<name>-<version>/, the files the package owns are created too
+    bool add_local(const std::vector<FakePackage>& pkgs);
+
+    // writes pacman.conf for the databases added so far, returns its path
+    auto write_conf() const -> std::string;
+
+    auto root() const noexcept -> const std::string& { return m_root; }
+    auto dbpath() const -> std::string { return m_root + "/var/lib/pacman"; }
+
+ private:
+    std::string m_root{};
+    std::vector<std::string> m_repos{};
+};
+
+struct FakeDbSpec {
+    std::size_t count{1000};
+    std::string prefix{"pkg"};
+    // packages form chains of dep_depth+1, each depending on the next one in its chain,
+    // so installing the first package of a chain (a multiple of dep_depth+1) pulls dep_depth more
+    std::size_t dep_depth{};
+    // every conflict_every-th package conflicts with package i-dep_depth-1, which is
+    // never part of its own dependency chain, and provides its name, 0 for none
+    std::size_t conflict_every{};
+    std::uint32_t seed{1};
+};
+
+// packages named "<prefix>NNNNN" with versions and descriptions derived from the seed
+auto generate_packages(const FakeDbSpec& spec) -> std::vector<FakePackage>;
+
+#endif  // FAKEDB_HPP
@@ -0,0 +1,128 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// find_upgrades against generated databases, including the pacman -Su
+// rules for overlapping repositories and ignored packages.
+
+#include "alpm_helper.hpp"
+#include "fakedb.hpp"
+#include "upgrades.hpp"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+class UpgradesTest : public ::testing::Test {
+ protected:
+    static void SetUpTestSuite() { spdlog::set_level(spdlog::level::warn); }
+
+    void TearDown() override { destroy_alpm(m_handle); }
+
+    alpm_handle_t* open() {
+        alpm_errno_t err{};
+        refresh_alpm(&m_handle, &err, m_root.write_conf());
+        EXPECT_NE(m_handle, nullptr) << alpm_strerror(err);
+        return m_handle;
+    }
+
+    FakeRoot m_root{};
+    alpm_handle_t* m_handle{};
+};
+
+FakePackage make_pkg(std::string name, std::string version, off_t isize = 1024) {
+    FakePackage pkg{};
+    pkg.name    = std::move(name);
+    pkg.version = std::move(version);
+    pkg.isize   = isize;
+    return pkg;
+}
+
+std::vector<std::string_view> names(const UpgradeReport& report) {
+    std::vector<std::string_view> res{};
+    for (const auto& upgrade : report.upgrades) {
+        res.push_back(upgrade.name);
+    }
+    return res;
+}
+
+TEST_F(UpgradesTest, OnlyNewerVersionsAreUpgrades) {
+    ASSERT_TRUE(m_root.add_sync_db("core", {make_pkg("equal", "1.0-1"), make_pkg("newer", "1.1-1", 4096), make_pkg("older", "0.9-1"), make_pkg("epoch", "1:0.1-1"), make_pkg("notinstalled", "1.0-1")}));
+    ASSERT_TRUE(m_root.add_local({make_pkg("epoch", "9.9-1"), make_pkg("equal", "1.0-1"), make_pkg("newer", "1.0-1"), make_pkg("older", "1.0-1"), make_pkg("foreign", "1.0-1")}));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    const auto& report = find_upgrades(handle);
+    ASSERT_EQ(names(report), (std::vector<std::string_view>{"epoch", "newer"}));
+
+    const auto& newer = report.upgrades[1];
+    EXPECT_EQ(newer.old_version, "1.0-1");
+    EXPECT_EQ(newer.new_version, "1.1-1");
+    EXPECT_EQ(newer.repo, "core");
+    EXPECT_EQ(newer.installed_size_change, 3072);
+    EXPECT_EQ(report.installed_size_change, 3072);
+    EXPECT_EQ(report.download_size, report.upgrades[0].download_size + newer.download_size);
+}
+
+TEST_F(UpgradesTest, FirstRepositoryWins) {
+    // pacman -Su takes the package from the first repository carrying the name
+    // and doesn't look further, even if a later one has a newer version
+    ASSERT_TRUE(m_root.add_sync_db("testing", {make_pkg("a", "2.0-1"), make_pkg("b", "1.0-1")}));
+    ASSERT_TRUE(m_root.add_sync_db("core", {make_pkg("a", "3.0-1"), make_pkg("b", "5.0-1"), make_pkg("c", "2.0-1")}));
+    ASSERT_TRUE(m_root.add_local({make_pkg("a", "1.0-1"), make_pkg("b", "1.0-1"), make_pkg("c", "1.0-1")}));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    const auto& report = find_upgrades(handle);
+    ASSERT_EQ(names(report), (std::vector<std::string_view>{"a", "c"}));
+    EXPECT_EQ(report.upgrades[0].new_version, "2.0-1");
+    EXPECT_EQ(report.upgrades[0].repo, "testing");
+    EXPECT_EQ(report.upgrades[1].repo, "core");
+}
+
+TEST_F(UpgradesTest, IgnoredPackagesAreSkipped) {
+    ASSERT_TRUE(m_root.add_sync_db("core", {make_pkg("kept", "2.0-1"), make_pkg("pinned", "2.0-1")}));
+    ASSERT_TRUE(m_root.add_local({make_pkg("kept", "1.0-1"), make_pkg("pinned", "1.0-1")}));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+    ASSERT_EQ(alpm_option_add_ignorepkg(handle, "pinned"), 0);
+
+    EXPECT_EQ(names(find_upgrades(handle)), (std::vector<std::string_view>{"kept"}));
+}
+
+TEST_F(UpgradesTest, MatchesPairwiseCompareAcrossChunks) {
+    // enough installed packages for several chunks and worker threads
+    const auto& available = generate_packages({.count = 20000, .seed = 1});
+    const auto& installed = generate_packages({.count = 5000, .seed = 2});
+    ASSERT_TRUE(m_root.add_sync_db("core", available));
+    ASSERT_TRUE(m_root.add_local(installed));
+    auto* handle = open();
+    ASSERT_NE(handle, nullptr);
+
+    std::vector<std::string_view> expected{};
+    for (std::size_t i = 0; i < installed.size(); ++i) {
+        if (alpm_pkg_vercmp(available[i].version.c_str(), installed[i].version.c_str()) > 0) {
+            expected.push_back(installed[i].name);
+        }
+    }
+    ASSERT_FALSE(expected.empty());
+
+    const auto& report = find_upgrades(handle);
+    EXPECT_EQ(names(report), expected);
+    EXPECT_TRUE(std::is_sorted(report.upgrades.begin(), report.upgrades.end(), [](auto&& lhs, auto&& rhs) { return lhs.name < rhs.name; }));
+}
+}  // namespace
@@ -0,0 +1,134 @@
+// Copyright (C) 2022 Vladislav Nepogodin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// VersionNumber must order exactly like alpm_pkg_vercmp, checked on
+// pacman's own test vectors and on random strings built to hit the
+// corner cases of rpmvercmp.
+
+#include "versionnumber.hpp"
+
+#include <alpm.h>
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+namespace {
+int vercmp(const std::string& first, const std::string& second) {
+    return VersionNumber::compare(VersionNumber{first}, VersionNumber{second});
+}
+
+// from pacman's test/util/vercmptest.sh
+TEST(VersionNumberTest, MatchesPacmanVectors) {
+    static constexpr std::tuple<const char*, const char*, int> cases[] = {
+        {"1.5.0", "1.5.0", 0},
+        {"1.5.1", "1.5.0", 1},
+        {"1.5.1", "1.5", 1},
+        {"1.5.0-1", "1.5.0-1", 0},
+        {"1.5.0-1", "1.5.0-2", -1},
+        {"1.5.0-1", "1.5.1-1", -1},
+        {"1.5.0-2", "1.5.1-1", -1},
+        {"1.5-1", "1.5", 0},
+        {"1.1-1", "1.1", 0},
+        {"1.0-1", "1.1", -1},
+        {"1.1-1", "1.0", 1},
+        {"1.5b-1", "1.5-1", -1},
+        {"1.5b", "1.5", -1},
+        {"1.5b-1", "1.5", -1},
+        {"1.5b", "1.5.1", -1},
+        {"1.0a", "1.0alpha", -1},
+        {"1.0alpha", "1.0b", -1},
+        {"1.0b", "1.0beta", -1},
+        {"1.0beta", "1.0rc", -1},
+        {"1.0rc", "1.0", -1},
+        {"1.5.a", "1.5", 1},
+        {"1.5.b", "1.5.a", 1},
+        {"1.5.1", "1.5.b", 1},
+        {"1.5.b-1", "1.5.b", 0},
+        {"1.5-1", "1.5.b", -1},
+        {"2.0", "2_0", 0},
+        {"2.0_a", "2_0.a", 0},
+        {"2.0a", "2.0.a", -1},
+        {"2___a", "2_a", 1},
+        {"0:1.0", "0:1.0", 0},
+        {"0:1.0", "0:1.1", -1},
+        {"1:1.0", "0:1.0", 1},
+        {"1:1.0", "0:1.1", 1},
+        {"1:1.0", "2:1.1", -1},
+        {"0:1.0", "1.0", 0},
+        {"0:1.0", "1.1", -1},
+        {"0:1.1", "1.0", 1},
+        {"1:1.0", "1.0", 1},
+        {"1:1.0", "1.1", 1},
+        {"1:1.1", "1.1", 1},
+        {"1.5.0", "1.5.0.0", -1},
+        {"1.05", "1.5", 0},
+        {"", "0", -1},
+    };
+    for (const auto& [first, second, expected] : cases) {
+        EXPECT_EQ(vercmp(first, second), expected) << first << " vs " << second;
+        EXPECT_EQ(vercmp(second, first), -expected) << second << " vs " << first;
+    }
+}
+
+TEST(VersionNumberTest, OperatorsAgreeWithCompare) {
+    const VersionNumber older{"1:2.0-1"};
+    const VersionNumber newer{"1:2.0.1-1"};
+    EXPECT_LT(older, newer);
+    EXPECT_LE(older, newer);
+    EXPECT_GT(newer, older);
+    EXPECT_NE(older, newer);
+    EXPECT_EQ(VersionNumber{"1.01-1"}, VersionNumber{"1.1-1"});
+    EXPECT_EQ(VersionNumber{}, VersionNumber{""});
+
+    // copies keep their segments
+    VersionNumber copy{older};
+    copy = newer;
+    EXPECT_EQ(copy <=> newer, std::weak_ordering::equivalent);
+    EXPECT_EQ(copy.toStringView(), "1:2.0.1-1");
+}
+
+// short strings over a small alphabet, so separators, epochs, releases,
+// leading zeros and letter/number boundaries keep colliding
+TEST(VersionNumberTest, DifferentialFuzzAgainstVercmp) {
+    static constexpr std::string_view alphabet{"000112789abzZ..-:_+~"};
+    std::mt19937 rng{std::random_device{}()};
+    const auto seed = rng();
+    rng.seed(seed);
+    std::uniform_int_distribution<std::size_t> length{0, 12};
+    std::uniform_int_distribution<std::size_t> pick{0, alphabet.size() - 1};
+
+    const auto random_version = [&] {
+        std::string str(length(rng), '\0');
+        for (auto& ch : str) {
+            ch = alphabet[pick(rng)];
+        }
+        return str;
+    };
+
+    for (int i = 0; i < 500000; ++i) {
+        const auto& first = random_version();
+        auto second       = random_version();
+        // near misses are the interesting cases
+        if (i % 2 == 0 && !first.empty()) {
+            second = first;
+            second[rng() % second.size()] = alphabet[pick(rng)];
+        }
+        const int expected = alpm_pkg_vercmp(first.c_str(), second.c_str());
+        ASSERT_EQ(vercmp(first, second), expected) << "'" << first << "' vs '" << second << "', seed " << seed;
+    }
+}
+}  // namespace